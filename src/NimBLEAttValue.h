@@ -36,6 +36,8 @@
 # include <cstring>
 # include <cstdint>
 
+# include "NimBLECodec.h"
+
 # ifndef MYNEWT_VAL_NIMBLE_CPP_ATT_VALUE_TIMESTAMP_ENABLED
 #  ifndef CONFIG_NIMBLE_CPP_ATT_VALUE_TIMESTAMP_ENABLED
 #   define MYNEWT_VAL_NIMBLE_CPP_ATT_VALUE_TIMESTAMP_ENABLED 0
@@ -386,7 +388,36 @@ class NimBLEAttValue {
         if (!skipSizeCheck && size() < sizeof(T)) {
             return T();
         }
-        return *(reinterpret_cast<const T*>(m_attr_value));
+
+        // Copy rather than dereference, the buffer is not guaranteed to be aligned for T.
+        T v;
+        memcpy(&v, m_attr_value, sizeof(T));
+        return v;
+    }
+
+    /**
+     * @brief Template to set the value by encoding fields with a NimBLESchema.
+     * @tparam Schema The NimBLESchema type describing the payload layout.
+     * @param [in] values The field values, in schema order.
+     * @return True if successful.
+     * @details <b>Use:</b> <tt>setFields<MySchema>(field1, field2, ...);</tt>
+     */
+    template <typename Schema, typename... Args>
+    bool setFields(const Args&... values) {
+        const typename Schema::buffer_type buf = Schema::pack(values...);
+        return setValue(buf.data(), buf.size());
+    }
+
+    /**
+     * @brief Template to decode the value into fields with a NimBLESchema.
+     * @tparam Schema The NimBLESchema type describing the payload layout.
+     * @param [out] values References to the variables to receive the field values, in schema order.
+     * @return True if the value was at least the schema size and the fields were decoded.
+     * @details <b>Use:</b> <tt>getFields<MySchema>(field1, field2, ...);</tt>
+     */
+    template <typename Schema, typename... Args>
+    bool getFields(Args&... values) const {
+        return Schema::decode(m_attr_value, m_attr_len, values...);
     }
 
     /*********************** Operators ************************/
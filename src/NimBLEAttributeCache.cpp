@@ -0,0 +1,138 @@
+/*
+ * Copyright 2020-2025 Ryan Powell <ryan@nable-embedded.io> and
+ * esp-nimble-cpp, NimBLE-Arduino contributors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "NimBLEAttributeCache.h"
+#if CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_CENTRAL) && defined(ESP_PLATFORM)
+
+# include "NimBLELog.h"
+
+# include "nvs.h"
+
+# include <stdio.h>
+
+static const char* LOG_TAG = "NimBLEAttributeCache";
+
+/**
+ * @brief Create the NVS key of a peer, the address type followed by the address in hex.
+ * @details NVS keys are limited to 15 characters, this uses 13.
+ */
+static void makeKey(const NimBLEAddress& peerId, char (&key)[16]) {
+    const uint8_t* val = peerId.getVal();
+    snprintf(key,
+             sizeof(key),
+             "%u%02x%02x%02x%02x%02x%02x",
+             peerId.getType(),
+             val[5],
+             val[4],
+             val[3],
+             val[2],
+             val[1],
+             val[0]);
+} // makeKey
+
+/**
+ * @brief Construct an NVS attribute cache store.
+ * @param [in] nvsNamespace The NVS namespace to keep the records in, must have static storage duration.
+ * @details NVS must be initialized before the store is used, NimBLEDevice::init does this.
+ */
+NimBLEAttributeCacheNvs::NimBLEAttributeCacheNvs(const char* nvsNamespace) : m_namespace{nvsNamespace} {}
+
+/**
+ * @brief Load the record of a peer from NVS.
+ * @param [in] peerId The identity address of the peer.
+ * @param [out] data The buffer to receive the record.
+ * @return True if a record was found and loaded.
+ */
+bool NimBLEAttributeCacheNvs::load(const NimBLEAddress& peerId, std::vector<uint8_t>& data) {
+    nvs_handle_t handle;
+    if (nvs_open(m_namespace, NVS_READONLY, &handle) != ESP_OK) {
+        return false;
+    }
+
+    char key[16];
+    makeKey(peerId, key);
+
+    size_t    len = 0;
+    esp_err_t err = nvs_get_blob(handle, key, nullptr, &len);
+    if (err == ESP_OK) {
+        data.resize(len);
+        err = nvs_get_blob(handle, key, data.data(), &len);
+    }
+
+    nvs_close(handle);
+    if (err != ESP_OK && err != ESP_ERR_NVS_NOT_FOUND) {
+        NIMBLE_LOGE(LOG_TAG, "Failed to load record %s, err=%d", key, err);
+    }
+
+    return err == ESP_OK;
+} // load
+
+/**
+ * @brief Store the record of a peer in NVS.
+ * @param [in] peerId The identity address of the peer.
+ * @param [in] data The record to store.
+ * @return True if the record was stored.
+ */
+bool NimBLEAttributeCacheNvs::store(const NimBLEAddress& peerId, const std::vector<uint8_t>& data) {
+    nvs_handle_t handle;
+    esp_err_t    err = nvs_open(m_namespace, NVS_READWRITE, &handle);
+    if (err != ESP_OK) {
+        NIMBLE_LOGE(LOG_TAG, "Failed to open NVS namespace %s, err=%d", m_namespace, err);
+        return false;
+    }
+
+    char key[16];
+    makeKey(peerId, key);
+
+    err = nvs_set_blob(handle, key, data.data(), data.size());
+    if (err == ESP_OK) {
+        err = nvs_commit(handle);
+    }
+
+    nvs_close(handle);
+    if (err != ESP_OK) {
+        NIMBLE_LOGE(LOG_TAG, "Failed to store record %s, err=%d", key, err);
+    }
+
+    return err == ESP_OK;
+} // store
+
+/**
+ * @brief Delete the record of a peer from NVS.
+ * @param [in] peerId The identity address of the peer.
+ * @return True if the record was deleted or did not exist.
+ */
+bool NimBLEAttributeCacheNvs::erase(const NimBLEAddress& peerId) {
+    nvs_handle_t handle;
+    esp_err_t    err = nvs_open(m_namespace, NVS_READWRITE, &handle);
+    if (err != ESP_OK) {
+        return err == ESP_ERR_NVS_NOT_FOUND;
+    }
+
+    char key[16];
+    makeKey(peerId, key);
+
+    err = nvs_erase_key(handle, key);
+    if (err == ESP_OK) {
+        err = nvs_commit(handle);
+    }
+
+    nvs_close(handle);
+    return err == ESP_OK || err == ESP_ERR_NVS_NOT_FOUND;
+} // erase
+
+#endif // CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_CENTRAL) && defined(ESP_PLATFORM)
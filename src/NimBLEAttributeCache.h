@@ -0,0 +1,80 @@
+/*
+ * Copyright 2020-2025 Ryan Powell <ryan@nable-embedded.io> and
+ * esp-nimble-cpp, NimBLE-Arduino contributors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NIMBLE_CPP_ATTRIBUTE_CACHE_H_
+#define NIMBLE_CPP_ATTRIBUTE_CACHE_H_
+
+#include "syscfg/syscfg.h"
+#if CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_CENTRAL)
+
+# include "NimBLEAddress.h"
+
+# include <stdint.h>
+# include <vector>
+
+/**
+ * @brief Interface for the persistent storage of discovered remote attribute databases.
+ * @details NimBLEClient serializes the services, characteristics and descriptors it has discovered into a
+ * compact binary record and passes it to the store keyed by the identity address of the peer.
+ * Implement this class to keep the records in a file system or any other storage.
+ */
+class NimBLEAttributeCacheStore {
+  public:
+    virtual ~NimBLEAttributeCacheStore() {}
+
+    /**
+     * @brief Load the record of a peer.
+     * @param [in] peerId The identity address of the peer.
+     * @param [out] data The buffer to receive the record.
+     * @return True if a record was found and loaded.
+     */
+    virtual bool load(const NimBLEAddress& peerId, std::vector<uint8_t>& data) = 0;
+
+    /**
+     * @brief Store the record of a peer, replacing any existing record.
+     * @param [in] peerId The identity address of the peer.
+     * @param [in] data The record to store.
+     * @return True if the record was stored.
+     */
+    virtual bool store(const NimBLEAddress& peerId, const std::vector<uint8_t>& data) = 0;
+
+    /**
+     * @brief Delete the record of a peer.
+     * @param [in] peerId The identity address of the peer.
+     * @return True if the record was deleted or did not exist.
+     */
+    virtual bool erase(const NimBLEAddress& peerId) = 0;
+}; // NimBLEAttributeCacheStore
+
+# ifdef ESP_PLATFORM
+/**
+ * @brief An attribute cache store that keeps the records as blobs in the NVS partition.
+ */
+class NimBLEAttributeCacheNvs : public NimBLEAttributeCacheStore {
+  public:
+    NimBLEAttributeCacheNvs(const char* nvsNamespace = "nimble_att");
+    bool load(const NimBLEAddress& peerId, std::vector<uint8_t>& data) override;
+    bool store(const NimBLEAddress& peerId, const std::vector<uint8_t>& data) override;
+    bool erase(const NimBLEAddress& peerId) override;
+
+  private:
+    const char* m_namespace;
+}; // NimBLEAttributeCacheNvs
+# endif
+
+#endif // CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_CENTRAL)
+#endif // NIMBLE_CPP_ATTRIBUTE_CACHE_H_
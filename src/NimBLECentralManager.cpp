@@ -0,0 +1,731 @@
+/*
+ * Copyright 2020-2025 Ryan Powell <ryan@nable-embedded.io> and
+ * esp-nimble-cpp, NimBLE-Arduino contributors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "NimBLECentralManager.h"
+#if CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_CENTRAL)
+
+# include "NimBLEClient.h"
+# include "NimBLERemoteService.h"
+# include "NimBLERemoteCharacteristic.h"
+# include "NimBLEDevice.h"
+# include "NimBLEUtils.h"
+# include "NimBLELog.h"
+
+# ifdef USING_NIMBLE_ARDUINO_HEADERS
+#  include "nimble/porting/nimble/include/nimble/nimble_port.h"
+# else
+#  include "nimble/nimble_port.h"
+# endif
+
+# include <algorithm>
+# include <new>
+
+static const char*                        LOG_TAG = "NimBLECentralManager";
+static NimBLECentralManagerCallbacks      defaultCallbacks;
+static std::vector<NimBLECentralManager*> liveManagers;
+static constexpr uint32_t                 CONNECT_RETRY_MS = 1000; // Retry period of a failed auto-connect start.
+
+/**
+ * @brief Get the mutex of the manager state shared by the application tasks and the host task.
+ * @details Guards liveManagers and the peers, connection state and accept list changes of every manager,
+ * shared so a manager can be checked as alive before it is used. It is not held across the manager
+ * callbacks or client calls that may invoke them.
+ */
+static ble_npl_mutex& centralMutex() {
+    static struct CentralMutex {
+        CentralMutex() {
+            if (ble_npl_mutex_init(&m) != BLE_NPL_OK) {
+                NIMBLE_LOGE(LOG_TAG, "Failed to initialize central manager mutex");
+            }
+        }
+        ble_npl_mutex m{};
+    } s;
+    return s.m;
+} // centralMutex
+
+/**
+ * @brief Construct a central manager with no peers.
+ */
+NimBLECentralManager::NimBLECentralManager()
+    : m_pCallbacks{&defaultCallbacks},
+      m_connParams{16,
+                   16,
+                   BLE_GAP_INITIAL_CONN_ITVL_MIN,
+                   BLE_GAP_INITIAL_CONN_ITVL_MAX,
+                   BLE_GAP_INITIAL_CONN_LATENCY,
+                   BLE_GAP_INITIAL_SUPERVISION_TIMEOUT,
+                   BLE_GAP_INITIAL_CONN_MIN_CE_LEN,
+                   BLE_GAP_INITIAL_CONN_MAX_CE_LEN} {
+    ble_npl_callout_init(&m_retryTimer, nimble_port_get_dflt_eventq(), NimBLECentralManager::connectRetryCb, this);
+
+    NimBLEMutexGuard lock(centralMutex());
+    if (!lock) {
+        NIMBLE_LOGE(LOG_TAG, "Failed to lock, the manager will not connect");
+        return;
+    }
+
+    liveManagers.push_back(this);
+}
+
+/**
+ * @brief Destroy the manager and the clients of its peers.
+ * @details Connected peers are disconnected. The manager must not be destroyed while a peer is being set up.
+ */
+NimBLECentralManager::~NimBLECentralManager() {
+    std::vector<Peer*> peers;
+    {
+        // A cancelled auto-connect reports to handleConnectEvent after this returns. If the lock cannot be
+        // taken the manager was never registered and the host task has not seen its state.
+        NimBLEMutexGuard lock(centralMutex());
+        liveManagers.erase(std::remove(liveManagers.begin(), liveManagers.end(), this), liveManagers.end());
+        m_running = false;
+        if (m_connecting) {
+            ble_gap_conn_cancel();
+        }
+        peers.swap(m_peers);
+    }
+
+    ble_npl_callout_stop(&m_retryTimer);
+    ble_npl_callout_deinit(&m_retryTimer);
+
+    for (const auto& address : m_removed) {
+        NimBLEDevice::whiteListRemove(address);
+    }
+
+    for (auto pPeer : peers) {
+        if (pPeer->pClient->isConnected()) {
+            ble_gap_set_event_cb(pPeer->pClient->getConnHandle(), NimBLEClient::handleGapEvent, pPeer->pClient);
+        }
+
+        NimBLEDevice::whiteListRemove(pPeer->pClient->getPeerAddress());
+        NimBLEDevice::deleteClient(pPeer->pClient);
+        delete pPeer;
+    }
+} // ~NimBLECentralManager
+
+/**
+ * @brief Add a peer to connect to.
+ * @param [in] address The address of the peer.
+ * @return A pointer to the client of the peer, or nullptr if no client could be created.
+ * @details The client can be configured, for example with an attribute cache, before the manager is started.
+ */
+NimBLEClient* NimBLECentralManager::addPeer(const NimBLEAddress& address) {
+    NimBLEMutexGuard lock(centralMutex());
+    if (!lock) {
+        return nullptr;
+    }
+
+    for (auto pPeer : m_peers) {
+        if (pPeer->pClient->getPeerAddress() == address) {
+            return pPeer->pClient;
+        }
+    }
+
+    NimBLEClient* pClient = NimBLEDevice::createClient(address);
+    if (pClient == nullptr) {
+        NIMBLE_LOGE(LOG_TAG, "Failed to create client for %s", address.toString().c_str());
+        return nullptr;
+    }
+
+    auto pPeer = new (std::nothrow) Peer(this, pClient);
+    if (pPeer == nullptr) {
+        NimBLEDevice::deleteClient(pClient);
+        return nullptr;
+    }
+
+    // Connection retries would bypass the accept list procedure and the event routing of the manager.
+    pClient->setConnectRetries(0);
+    m_peers.push_back(pPeer);
+    m_removed.erase(std::remove(m_removed.begin(), m_removed.end(), address), m_removed.end());
+    m_acceptListDirty = true;
+    updateConnect();
+    return pClient;
+} // addPeer
+
+/**
+ * @brief Remove a peer and delete its client.
+ * @param [in] address The address of the peer.
+ * @return True if the peer was removed, false if it was not found or is connected.
+ * @details The address is removed from the accept list once a pending auto-connect has been cancelled.
+ */
+bool NimBLECentralManager::removePeer(const NimBLEAddress& address) {
+    NimBLEMutexGuard lock(centralMutex());
+    if (!lock) {
+        return false;
+    }
+
+    for (auto it = m_peers.begin(); it != m_peers.end(); ++it) {
+        auto pPeer = *it;
+        if (pPeer->pClient->getPeerAddress() != address) {
+            continue;
+        }
+
+        if (pPeer->state != PEER_IDLE) {
+            NIMBLE_LOGE(LOG_TAG, "Cannot remove connected peer %s", address.toString().c_str());
+            return false;
+        }
+
+        m_peers.erase(it);
+        m_removed.push_back(address);
+        NimBLEDevice::deleteClient(pPeer->pClient);
+        delete pPeer;
+        m_acceptListDirty = true;
+        updateConnect();
+        return true;
+    }
+
+    return false;
+} // removePeer
+
+/**
+ * @brief Add a characteristic to subscribe to on each peer after discovery.
+ * @param [in] serviceUUID The UUID of the service of the characteristic.
+ * @param [in] charUUID The UUID of the characteristic.
+ * @param [in] notifications If true, subscribe for notifications, false subscribe for indications.
+ * @details Peers that do not have the characteristic are skipped. Notifications are delivered to
+ * the callback set on the characteristic, or can be read from its value.
+ */
+void NimBLECentralManager::addSubscription(const NimBLEUUID& serviceUUID,
+                                           const NimBLEUUID& charUUID,
+                                           bool              notifications) {
+    NimBLEMutexGuard lock(centralMutex());
+    if (lock) {
+        m_subscriptions.emplace_back(serviceUUID, charUUID, notifications);
+    }
+} // addSubscription
+
+/**
+ * @brief Set the callbacks of the manager.
+ * @param [in] pCallbacks A pointer to the callbacks, nullptr to use the default callbacks.
+ */
+void NimBLECentralManager::setCallbacks(NimBLECentralManagerCallbacks* pCallbacks) {
+    m_pCallbacks = pCallbacks ? pCallbacks : &defaultCallbacks;
+} // setCallbacks
+
+/**
+ * @brief Set the connection parameters of new connections.
+ * @param [in] minInterval The minimum connection interval in 1.25ms units.
+ * @param [in] maxInterval The maximum connection interval in 1.25ms units.
+ * @param [in] latency The number of packets allowed to skip (extends max interval).
+ * @param [in] timeout The timeout time in 10ms units before disconnecting.
+ */
+void NimBLECentralManager::setConnectionParams(uint16_t minInterval,
+                                               uint16_t maxInterval,
+                                               uint16_t latency,
+                                               uint16_t timeout) {
+    m_connParams.itvl_min            = minInterval;
+    m_connParams.itvl_max            = maxInterval;
+    m_connParams.latency             = latency;
+    m_connParams.supervision_timeout = timeout;
+} // setConnectionParams
+
+/**
+ * @brief Set the data length requested on each link after connecting.
+ * @param [in] txOctets The preferred number of payload octets (0x001B-0x00FB), 0 to not request an update.
+ */
+void NimBLECentralManager::setDataLen(uint16_t txOctets) {
+    m_dataLen = txOctets;
+} // setDataLen
+
+/**
+ * @brief Set the PHY requested on each link after connecting.
+ * @param [in] phyMask A bitmask of BLE_GAP_LE_PHY_*_MASK values, 0 to not request an update.
+ */
+void NimBLECentralManager::setPreferredPhy(uint8_t phyMask) {
+    m_phyMask = phyMask;
+} // setPreferredPhy
+
+/**
+ * @brief Set if the MTU is exchanged on each link after connecting.
+ * @param [in] exchangeMTU True to exchange the MTU, the default.
+ */
+void NimBLECentralManager::setExchangeMTU(bool exchangeMTU) {
+    m_exchangeMTU = exchangeMTU;
+} // setExchangeMTU
+
+/**
+ * @brief Start connecting to the peers that are not connected.
+ * @return True if the manager was started.
+ */
+bool NimBLECentralManager::start() {
+    if (!NimBLEDevice::m_synced) {
+        NIMBLE_LOGE(LOG_TAG, "Host not synced with controller.");
+        return false;
+    }
+
+    NimBLEMutexGuard lock(centralMutex());
+    if (!lock) {
+        return false;
+    }
+
+    m_running         = true;
+    m_acceptListDirty = true;
+    updateConnect();
+    return true;
+} // start
+
+/**
+ * @brief Stop connecting to peers, established links are kept.
+ */
+void NimBLECentralManager::stop() {
+    NimBLEMutexGuard lock(centralMutex());
+    if (!lock) {
+        return;
+    }
+
+    m_running = false;
+    if (m_connecting) {
+        ble_gap_conn_cancel();
+    }
+} // stop
+
+/**
+ * @brief Check if the manager is connecting to its peers.
+ * @return True if started.
+ */
+bool NimBLECentralManager::isRunning() const {
+    return m_running;
+} // isRunning
+
+/**
+ * @brief Get the number of peers of the manager.
+ * @return The number of peers.
+ */
+size_t NimBLECentralManager::getPeerCount() const {
+    NimBLEMutexGuard lock(centralMutex());
+    return lock ? m_peers.size() : 0;
+} // getPeerCount
+
+/**
+ * @brief Get the number of peers that are connected and set up.
+ * @return The number of ready peers.
+ */
+size_t NimBLECentralManager::getReadyCount() const {
+    NimBLEMutexGuard lock(centralMutex());
+    size_t           count = 0;
+    if (!lock) {
+        return 0;
+    }
+
+    for (const auto pPeer : m_peers) {
+        if (pPeer->state == PEER_READY) {
+            count++;
+        }
+    }
+
+    return count;
+} // getReadyCount
+
+/**
+ * @brief Find the peer with the given address.
+ * @param [in] addr The address to look for.
+ * @return A pointer to the peer or nullptr if not found.
+ * @details Must be called with the manager lock held.
+ */
+NimBLECentralManager::Peer* NimBLECentralManager::findPeer(const ble_addr_t* addr) const {
+    const NimBLEAddress address(*addr);
+    for (const auto pPeer : m_peers) {
+        if (pPeer->pClient->getPeerAddress() == address) {
+            return pPeer;
+        }
+    }
+
+    return nullptr;
+} // findPeer
+
+/**
+ * @brief Bring the accept list and the auto-connect procedure in line with the peers that are not connected.
+ * @details The accept list cannot be changed while a connection is being created, the procedure is
+ * cancelled first and this is called again from the resulting connect event. Must be called with the
+ * manager lock held.
+ */
+void NimBLECentralManager::updateConnect() {
+    if (m_connecting) {
+        if (m_acceptListDirty || !m_running) {
+            ble_gap_conn_cancel();
+        }
+        return;
+    }
+
+    bool idle = false;
+    if (m_acceptListDirty) {
+        for (const auto& address : m_removed) {
+            NimBLEDevice::whiteListRemove(address);
+        }
+        m_removed.clear();
+
+        for (const auto pPeer : m_peers) {
+            if (pPeer->state == PEER_IDLE) {
+                NimBLEDevice::whiteListAdd(pPeer->pClient->getPeerAddress());
+                idle = true;
+            } else {
+                NimBLEDevice::whiteListRemove(pPeer->pClient->getPeerAddress());
+            }
+        }
+
+        m_acceptListDirty = false;
+    } else {
+        for (const auto pPeer : m_peers) {
+            idle |= pPeer->state == PEER_IDLE;
+        }
+    }
+
+    if (!m_running || !idle) {
+        return;
+    }
+
+    // A null peer address selects the accept list filter policy.
+# if MYNEWT_VAL(BLE_EXT_ADV)
+    int rc = ble_gap_ext_connect(NimBLEDevice::m_ownAddrType,
+                                 nullptr,
+                                 BLE_HS_FOREVER,
+                                 BLE_GAP_LE_PHY_1M_MASK,
+                                 &m_connParams,
+                                 &m_connParams,
+                                 &m_connParams,
+                                 NimBLECentralManager::handleConnectEvent,
+                                 this);
+# else
+    int rc = ble_gap_connect(NimBLEDevice::m_ownAddrType,
+                             nullptr,
+                             BLE_HS_FOREVER,
+                             &m_connParams,
+                             NimBLECentralManager::handleConnectEvent,
+                             this);
+# endif
+    if (rc != 0) {
+        NIMBLE_LOGE(LOG_TAG, "Failed to start auto connect, rc=%d %s", rc, NimBLEUtils::returnCodeToString(rc));
+        ble_npl_callout_reset(&m_retryTimer, ble_npl_time_ms_to_ticks32(CONNECT_RETRY_MS));
+        return;
+    }
+
+    m_connecting = true;
+} // updateConnect
+
+/**
+ * @brief Retry starting the auto-connect procedure after it failed to start.
+ * @param [in] event The callout event, its argument is the manager.
+ */
+void NimBLECentralManager::connectRetryCb(struct ble_npl_event* event) {
+    auto             pManager = static_cast<NimBLECentralManager*>(ble_npl_event_get_arg(event));
+    NimBLEMutexGuard lock(centralMutex());
+    if (lock && std::find(liveManagers.begin(), liveManagers.end(), pManager) != liveManagers.end()) {
+        pManager->updateConnect();
+    }
+} // connectRetryCb
+
+/**
+ * @brief Handle the result of the auto-connect procedure.
+ * @param [in] event The GAP event.
+ * @param [in] arg A pointer to the manager.
+ */
+int NimBLECentralManager::handleConnectEvent(struct ble_gap_event* event, void* arg) {
+    auto pManager = static_cast<NimBLECentralManager*>(arg);
+    if (event->type != BLE_GAP_EVENT_CONNECT) {
+        return 0;
+    }
+
+    Peer* pPeer = nullptr;
+    {
+        NimBLEMutexGuard lock(centralMutex());
+        if (!lock || std::find(liveManagers.begin(), liveManagers.end(), pManager) == liveManagers.end()) {
+            if (event->connect.status == 0) {
+                ble_gap_terminate(event->connect.conn_handle, BLE_ERR_REM_USER_CONN_TERM);
+            }
+            return 0;
+        }
+
+        pManager->m_connecting = false;
+        int rc                 = event->connect.status;
+        if (rc == BLE_ERR_UNSUPP_REM_FEATURE) {
+            rc = 0; // Not a real error, see NimBLEClient::handleGapEvent.
+        }
+
+        if (rc == 0) {
+            ble_gap_conn_desc desc;
+            if (ble_gap_conn_find(event->connect.conn_handle, &desc) == 0) {
+                pPeer = pManager->findPeer(&desc.peer_id_addr);
+                if (pPeer == nullptr) {
+                    pPeer = pManager->findPeer(&desc.peer_ota_addr);
+                }
+            }
+
+            if (pPeer == nullptr || pPeer->state != PEER_IDLE) {
+                NIMBLE_LOGW(LOG_TAG, "Connected to unexpected peer, disconnecting");
+                ble_gap_terminate(event->connect.conn_handle, BLE_ERR_REM_USER_CONN_TERM);
+                pPeer = nullptr;
+            } else {
+                // A peer being set up cannot be removed, so it can be used once the lock is released.
+                pPeer->state       = PEER_SETUP;
+                pPeer->subIdx      = 0;
+                pPeer->discovered  = false;
+                pPeer->securing    = false;
+                pPeer->secureTried = false;
+                pPeer->keyRetried  = false;
+                ble_gap_set_event_cb(event->connect.conn_handle, NimBLECentralManager::handleLinkEvent, pPeer);
+            }
+
+            pManager->m_acceptListDirty = true;
+        } else {
+            NIMBLE_LOGD(LOG_TAG, "Auto connect ended, rc=%d %s", rc, NimBLEUtils::returnCodeToString(rc));
+        }
+
+        pManager->updateConnect();
+    }
+
+    if (pPeer != nullptr) {
+        NIMBLE_LOGD(LOG_TAG, "Connected to %s", pPeer->pClient->getPeerAddress().toString().c_str());
+        pPeer->pClient->adoptConnection(event, pManager->m_exchangeMTU, [pPeer](NimBLEClient*, int rc) {
+            pPeer->pManager->onLinkConnected(pPeer, rc);
+        });
+    }
+
+    return 0;
+} // handleConnectEvent
+
+/**
+ * @brief Handle the GAP events of a managed link, passing them to the client of the peer.
+ * @param [in] event The GAP event.
+ * @param [in] arg A pointer to the peer.
+ */
+int NimBLECentralManager::handleLinkEvent(struct ble_gap_event* event, void* arg) {
+    auto pPeer = static_cast<Peer*>(arg);
+    int  rc    = NimBLEClient::handleGapEvent(event, pPeer->pClient);
+    if (event->type == BLE_GAP_EVENT_ENC_CHANGE) {
+        pPeer->pManager->onEncryptionChange(pPeer, event->enc_change.status);
+    } else if (event->type == BLE_GAP_EVENT_DISCONNECT) {
+        auto          pManager = pPeer->pManager;
+        NimBLEClient* pClient  = pPeer->pClient;
+        {
+            NimBLEMutexGuard lock(centralMutex());
+            if (lock) {
+                pPeer->state                = PEER_IDLE;
+                pManager->m_acceptListDirty = true;
+                pManager->updateConnect();
+            }
+        }
+
+        pManager->m_pCallbacks->onPeerDisconnected(pClient, event->disconnect.reason);
+    }
+
+    return rc;
+} // handleLinkEvent
+
+/**
+ * @brief Start the setup of a link once the connection is established.
+ * @param [in] pPeer The peer of the link.
+ * @param [in] rc The result of the connection, if not 0 the link is already down.
+ */
+void NimBLECentralManager::onLinkConnected(Peer* pPeer, int rc) {
+    if (rc != 0) {
+        return;
+    }
+
+    NimBLEClient* pClient = pPeer->pClient;
+    if (m_dataLen) {
+        pClient->setDataLen(m_dataLen);
+    }
+
+    if (m_phyMask) {
+        pClient->updatePhy(m_phyMask, m_phyMask);
+    }
+
+    // A bonded peer usually requires encryption for its CCCDs, encrypt before touching the attributes.
+    if (NimBLEDevice::isBonded(pClient->getPeerAddress()) && startSecurity(pPeer)) {
+        return;
+    }
+
+    discover(pPeer);
+} // onLinkConnected
+
+/**
+ * @brief Start the security of a link being set up, the setup resumes on the encryption change.
+ * @param [in] pPeer The peer being set up.
+ * @return True if security was started, false if it was already tried on this link or could not be started.
+ */
+bool NimBLECentralManager::startSecurity(Peer* pPeer) {
+    if (pPeer->secureTried) {
+        return false;
+    }
+
+    pPeer->secureTried = true;
+    if (!pPeer->pClient->secureConnection(true)) {
+        return false;
+    }
+
+    pPeer->securing = true;
+    return true;
+} // startSecurity
+
+/**
+ * @brief Resume the setup of a peer once the link security has changed.
+ * @param [in] pPeer The peer of the link.
+ * @param [in] status The status of the encryption change.
+ */
+void NimBLECentralManager::onEncryptionChange(Peer* pPeer, int status) {
+    if (!pPeer->securing) {
+        return;
+    }
+
+    // The client deleted the stale bond and started pairing again, wait for that result.
+    if (status == BLE_HS_HCI_ERR(BLE_ERR_PINKEY_MISSING) && !pPeer->keyRetried &&
+        pPeer->pClient->m_asyncSecureAttempt == 2) {
+        pPeer->keyRetried = true;
+        return;
+    }
+
+    pPeer->securing = false;
+    if (status != 0) {
+        setupFailed(pPeer, status);
+    } else if (!pPeer->discovered) {
+        discover(pPeer);
+    } else {
+        subscribeNext(pPeer);
+    }
+} // onEncryptionChange
+
+/**
+ * @brief Check if a setup step failed for lack of security.
+ */
+static bool isSecurityError(int rc) {
+    return rc == BLE_HS_ATT_ERR(BLE_ATT_ERR_INSUFFICIENT_AUTHEN) ||
+           rc == BLE_HS_ATT_ERR(BLE_ATT_ERR_INSUFFICIENT_AUTHOR) ||
+           rc == BLE_HS_ATT_ERR(BLE_ATT_ERR_INSUFFICIENT_ENC);
+} // isSecurityError
+
+/**
+ * @brief Discover the attributes of a peer being set up, then subscribe.
+ * @param [in] pPeer The peer being set up.
+ */
+void NimBLECentralManager::discover(Peer* pPeer) {
+    auto onDiscovered = [pPeer](NimBLEClient*, int rc) {
+        if (rc != 0) {
+            if (!isSecurityError(rc) || !pPeer->pManager->startSecurity(pPeer)) {
+                pPeer->pManager->setupFailed(pPeer, rc);
+            }
+            return;
+        }
+
+        pPeer->discovered = true;
+        pPeer->pManager->subscribeNext(pPeer);
+    };
+
+    NimBLEClient* pClient = pPeer->pClient;
+    if (!pClient->discoverAttributesAsync(onDiscovered)) {
+        setupFailed(pPeer, pClient->getLastError());
+    }
+} // discover
+
+/**
+ * @brief Subscribe to the next configured characteristic of a peer, the peer is ready after the last one.
+ * @param [in] pPeer The peer being set up.
+ */
+void NimBLECentralManager::subscribeNext(Peer* pPeer) {
+    for (;;) {
+        Subscription sub{NimBLEUUID(), NimBLEUUID(), true};
+        {
+            NimBLEMutexGuard lock(centralMutex());
+            if (!lock) {
+                setupFailed(pPeer, BLE_HS_EOS);
+                return;
+            }
+
+            if (pPeer->subIdx >= m_subscriptions.size()) {
+                pPeer->state = PEER_READY;
+                break;
+            }
+
+            sub = m_subscriptions[pPeer->subIdx++];
+        }
+
+        NimBLERemoteCharacteristic* pChr = nullptr;
+        for (const auto pSvc : pPeer->pClient->m_svcVec) {
+            if (pSvc->getUUID() == sub.serviceUUID) {
+                for (const auto pCandidate : pSvc->getCharacteristics(false)) {
+                    if (pCandidate->getUUID() == sub.charUUID) {
+                        pChr = pCandidate;
+                        break;
+                    }
+                }
+                break;
+            }
+        }
+
+        if (pChr == nullptr || !(pChr->canNotify() || pChr->canIndicate())) {
+            continue;
+        }
+
+        auto onDone = [pPeer](NimBLERemoteValueAttribute*, int rc) {
+            if (rc != 0) {
+                if (isSecurityError(rc) && pPeer->pManager->startSecurity(pPeer)) {
+                    pPeer->subIdx--; // Subscribe again once the link is secured.
+                } else {
+                    pPeer->pManager->setupFailed(pPeer, rc);
+                }
+                return;
+            }
+
+            pPeer->pManager->subscribeNext(pPeer);
+        };
+
+        // Keep the notify callbacks the application may have set on the characteristic.
+        if (pChr->setNotifyAsync(sub.notifications ? 0x01 : 0x02, pChr->m_notifyCallback, onDone)) {
+            return;
+        }
+
+        setupFailed(pPeer, BLE_HS_EUNKNOWN);
+        return;
+    }
+
+    NIMBLE_LOGD(LOG_TAG, "Peer %s ready", pPeer->pClient->getPeerAddress().toString().c_str());
+    m_pCallbacks->onPeerReady(pPeer->pClient);
+} // subscribeNext
+
+/**
+ * @brief Report a failed setup step and disconnect the peer.
+ * @param [in] pPeer The peer being set up.
+ * @param [in] rc The error code of the failed step.
+ */
+void NimBLECentralManager::setupFailed(Peer* pPeer, int rc) {
+    if (pPeer->state != PEER_SETUP) {
+        return; // The link went down while the step was in progress.
+    }
+
+    NIMBLE_LOGE(LOG_TAG,
+                "Setup of %s failed, rc=%d %s",
+                pPeer->pClient->getPeerAddress().toString().c_str(),
+                rc,
+                NimBLEUtils::returnCodeToString(rc));
+    m_pCallbacks->onPeerSetupFailed(pPeer->pClient, rc);
+    pPeer->pClient->disconnect();
+} // setupFailed
+
+static const char* CB_TAG = "NimBLECentralManagerCallbacks";
+
+void NimBLECentralManagerCallbacks::onPeerReady(NimBLEClient* pClient) {
+    NIMBLE_LOGD(CB_TAG, "onPeerReady: default");
+} // onPeerReady
+
+void NimBLECentralManagerCallbacks::onPeerSetupFailed(NimBLEClient* pClient, int reason) {
+    NIMBLE_LOGD(CB_TAG, "onPeerSetupFailed: default, reason: %d", reason);
+} // onPeerSetupFailed
+
+void NimBLECentralManagerCallbacks::onPeerDisconnected(NimBLEClient* pClient, int reason) {
+    NIMBLE_LOGD(CB_TAG, "onPeerDisconnected: default, reason: %d", reason);
+} // onPeerDisconnected
+
+#endif // CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_CENTRAL)
@@ -0,0 +1,156 @@
+/*
+ * Copyright 2020-2025 Ryan Powell <ryan@nable-embedded.io> and
+ * esp-nimble-cpp, NimBLE-Arduino contributors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NIMBLE_CPP_CENTRAL_MANAGER_H_
+#define NIMBLE_CPP_CENTRAL_MANAGER_H_
+
+#include "syscfg/syscfg.h"
+#if CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_CENTRAL)
+
+# ifdef USING_NIMBLE_ARDUINO_HEADERS
+#  include "nimble/nimble/host/include/host/ble_gap.h"
+#  include "nimble/nimble/include/nimble/nimble_npl.h"
+# else
+#  include "host/ble_gap.h"
+#  include "nimble/nimble_npl.h"
+# endif
+
+# include "NimBLEAddress.h"
+# include "NimBLEUUID.h"
+
+# include <stdint.h>
+# include <vector>
+
+class NimBLEClient;
+class NimBLECentralManagerCallbacks;
+
+/**
+ * @brief Connects to and sets up a set of peripherals concurrently.
+ * @details The peers are placed in the accept list and a single auto-connect procedure connects to
+ * whichever of them is seen first, restarting for the remaining peers after each connection.
+ * Each link is then set up from the host task without blocking: MTU exchange, data length, PHY,
+ * attribute discovery (restored from the attribute cache when possible) and subscriptions,
+ * so the setup of several links proceeds in parallel and their GATT procedures interleave. Bonded peers
+ * are encrypted before discovery, other peers are paired once if a step fails for lack of security.
+ * Disconnected peers are put back in the accept list and reconnected while the manager is running,
+ * an auto-connect that cannot be started, for example while scanning, is retried periodically.
+ *
+ * The manager routes the GAP events of its links, the clients must not be connected directly while
+ * they are managed. The clients are created by the manager and deleted with it. The peer list and
+ * connection state are shared with the host task under a lock, so peers can be added and removed while
+ * the manager is running.
+ */
+class NimBLECentralManager {
+  public:
+    NimBLECentralManager();
+    ~NimBLECentralManager();
+
+    NimBLEClient* addPeer(const NimBLEAddress& address);
+    bool          removePeer(const NimBLEAddress& address);
+    void          addSubscription(const NimBLEUUID& serviceUUID, const NimBLEUUID& charUUID, bool notifications = true);
+    void          setCallbacks(NimBLECentralManagerCallbacks* pCallbacks);
+    void          setConnectionParams(uint16_t minInterval, uint16_t maxInterval, uint16_t latency, uint16_t timeout);
+    void          setDataLen(uint16_t txOctets);
+    void          setPreferredPhy(uint8_t phyMask);
+    void          setExchangeMTU(bool exchangeMTU);
+    bool          start();
+    void          stop();
+    bool          isRunning() const;
+    size_t        getPeerCount() const;
+    size_t        getReadyCount() const;
+
+  private:
+    enum PeerState : uint8_t { PEER_IDLE, PEER_SETUP, PEER_READY };
+
+    struct Peer {
+        Peer(NimBLECentralManager* pManager, NimBLEClient* pClient) : pManager{pManager}, pClient{pClient} {}
+
+        NimBLECentralManager* pManager;
+        NimBLEClient*         pClient;
+        PeerState             state{PEER_IDLE};
+        size_t                subIdx{0};
+        bool                  discovered{false};  // The attributes have been discovered on this link.
+        bool                  securing{false};    // Waiting for the encryption change to resume the setup.
+        bool                  secureTried{false}; // Security has been started on this link.
+        bool                  keyRetried{false};  // The client re-paired after a missing key.
+    };
+
+    struct Subscription {
+        Subscription(const NimBLEUUID& svc, const NimBLEUUID& chr, bool notify)
+            : serviceUUID{svc}, charUUID{chr}, notifications{notify} {}
+
+        NimBLEUUID serviceUUID;
+        NimBLEUUID charUUID;
+        bool       notifications;
+    };
+
+    static int handleConnectEvent(struct ble_gap_event* event, void* arg);
+    static int  handleLinkEvent(struct ble_gap_event* event, void* arg);
+    static void connectRetryCb(struct ble_npl_event* event);
+    Peer*       findPeer(const ble_addr_t* addr) const;
+    void        updateConnect();
+    void        onLinkConnected(Peer* pPeer, int rc);
+    bool        startSecurity(Peer* pPeer);
+    void        onEncryptionChange(Peer* pPeer, int status);
+    void        discover(Peer* pPeer);
+    void        subscribeNext(Peer* pPeer);
+    void        setupFailed(Peer* pPeer, int rc);
+
+    std::vector<Peer*>             m_peers{};
+    std::vector<NimBLEAddress>     m_removed{};
+    std::vector<Subscription>      m_subscriptions{};
+    NimBLECentralManagerCallbacks* m_pCallbacks;
+    ble_gap_conn_params            m_connParams;
+    ble_npl_callout                m_retryTimer{};
+    uint16_t                       m_dataLen{0};
+    uint8_t                        m_phyMask{0};
+    bool                           m_exchangeMTU{true};
+    bool                           m_running{false};
+    bool                           m_connecting{false};
+    bool                           m_acceptListDirty{false};
+}; // NimBLECentralManager
+
+/**
+ * @brief Callbacks of a NimBLECentralManager, called from the host task.
+ */
+class NimBLECentralManagerCallbacks {
+  public:
+    virtual ~NimBLECentralManagerCallbacks() {}
+
+    /**
+     * @brief Called when a peer is connected and its setup is complete.
+     * @param [in] pClient The client of the peer.
+     */
+    virtual void onPeerReady(NimBLEClient* pClient);
+
+    /**
+     * @brief Called when the setup of a connected peer failed, the peer is disconnected afterwards.
+     * @param [in] pClient The client of the peer.
+     * @param [in] reason The error code of the failed step.
+     */
+    virtual void onPeerSetupFailed(NimBLEClient* pClient, int reason);
+
+    /**
+     * @brief Called when a managed peer disconnects, it is reconnected while the manager is running.
+     * @param [in] pClient The client of the peer.
+     * @param [in] reason The reason code of the disconnection.
+     */
+    virtual void onPeerDisconnected(NimBLEClient* pClient, int reason);
+}; // NimBLECentralManagerCallbacks
+
+#endif // CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_CENTRAL)
+#endif // NIMBLE_CPP_CENTRAL_MANAGER_H_
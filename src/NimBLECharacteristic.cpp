@@ -25,13 +25,560 @@
 #  endif
 # endif
 
+# ifdef USING_NIMBLE_ARDUINO_HEADERS
+#  include "nimble/porting/nimble/include/os/os_mbuf.h"
+#  include "nimble/porting/nimble/include/nimble/nimble_port.h"
+# else
+#  include "os/os_mbuf.h"
+#  include "nimble/nimble_port.h"
+# endif
+
 # include "NimBLE2904.h"
 # include "NimBLEDevice.h"
 # include "NimBLELog.h"
 
+# include <algorithm>
+# include <utility>
+
 static NimBLECharacteristicCallbacks defaultCallback;
 static const char*                   LOG_TAG = "NimBLECharacteristic";
 
+/** @brief Event callback that deletes a structure retired with deleteOnHostTask. */
+template <typename T>
+static void deleteEventCb(struct ble_npl_event* ev) {
+    delete static_cast<T*>(ble_npl_event_get_arg(ev));
+} // deleteEventCb
+
+/**
+ * @brief Delete a structure that host task handlers use without holding a lock.
+ * @details The deletion is posted to the host task so that it runs after any handler using the structure
+ * has returned, the structure must already be unlinked from the characteristic.
+ */
+template <typename T>
+static void deleteOnHostTask(T* p) {
+    if (p == nullptr) {
+        return;
+    }
+
+    if (!NimBLEDevice::isInitialized()) {
+        delete p;
+        return;
+    }
+
+    ble_npl_eventq_put(nimble_port_get_dflt_eventq(), &p->m_deleteEvent);
+} // deleteOnHostTask
+
+/**
+ * @brief Outbound notification queue, drained from the NimBLE host task.
+ */
+struct NimBLECharacteristic::NotifyQueue {
+    /** @brief A notification waiting in the queue. */
+    struct Item {
+        std::vector<uint8_t>   value{};
+        TargetArray            targets{};
+        uint8_t                numTargets{0};
+        uint8_t                nextTarget{0};
+        int                    rc{0};
+        NotifyCompleteCallback cb{nullptr};
+    };
+
+    /** @brief Construct a NotifyQueue with the specified depth. */
+    NotifyQueue(NimBLECharacteristic* pChr, uint8_t depth, NotifyQueuePolicy policy)
+        : m_slots(depth), m_policy(policy) {
+        ble_npl_event_init(&m_deleteEvent, deleteEventCb<NotifyQueue>, this);
+        memset(&m_mutex, 0, sizeof(m_mutex));
+        if (ble_npl_mutex_init(&m_mutex) != BLE_NPL_OK) {
+            NIMBLE_LOGE(LOG_TAG, "Failed to initialize notify queue mutex");
+            return;
+        }
+
+        if (ble_npl_callout_init(&m_retryTimer, nimble_port_get_dflt_eventq(), NimBLECharacteristic::notifyQueueEventCb, pChr) !=
+            0) {
+            NIMBLE_LOGE(LOG_TAG, "Failed to initialize notify queue callout");
+            ble_npl_mutex_deinit(&m_mutex);
+            return;
+        }
+
+        ble_npl_event_init(&m_drainEvent, NimBLECharacteristic::notifyQueueEventCb, pChr);
+        m_valid = true;
+    }
+
+    /** @brief Destroy the NotifyQueue and release resources. */
+    ~NotifyQueue() {
+        ble_npl_eventq_remove(nimble_port_get_dflt_eventq(), &m_deleteEvent);
+        ble_npl_event_deinit(&m_deleteEvent);
+        if (!m_valid) {
+            return;
+        }
+
+        cancel();
+        ble_npl_callout_deinit(&m_retryTimer);
+        ble_npl_event_deinit(&m_drainEvent);
+        ble_npl_mutex_deinit(&m_mutex);
+    }
+
+    /** @brief Stop the drain events, they reference the characteristic. */
+    void cancel() {
+        if (m_valid) {
+            ble_npl_callout_stop(&m_retryTimer);
+            ble_npl_eventq_remove(nimble_port_get_dflt_eventq(), &m_drainEvent);
+        }
+    }
+
+    /**
+     * @brief Add a value to the back of the queue.
+     * @return True if the value was queued.
+     * @details The completion callback of an item discarded to make room is reported by the drain.
+     */
+    bool push(const uint8_t*          value,
+              size_t                  length,
+              const TargetArray&      targets,
+              uint8_t                 numTargets,
+              NotifyCompleteCallback& cb) {
+        NimBLEMutexGuard g(m_mutex);
+        if (!g) {
+            return false;
+        }
+
+        if (m_count == m_slots.size()) {
+            if (m_policy == DROP_NEW) {
+                return false;
+            }
+
+            if (m_slots[m_head].cb) {
+                m_completions.emplace_back(std::move(m_slots[m_head].cb), BLE_HS_EPREEMPTED);
+            }
+            m_head = (m_head + 1) % m_slots.size();
+            m_count--;
+        }
+
+        auto& item = m_slots[(m_head + m_count) % m_slots.size()];
+        item.value.assign(value, value + length);
+        item.targets    = targets;
+        item.numTargets = numTargets;
+        item.nextTarget = 0;
+        item.rc         = 0;
+        item.cb         = std::move(cb);
+        m_count++;
+        return true;
+    }
+
+    /**
+     * @brief Move the item at the front of the queue into the in-flight slot.
+     * @return True if an item was available.
+     */
+    bool popInflight() {
+        NimBLEMutexGuard g(m_mutex);
+        if (!g || m_count == 0) {
+            return false;
+        }
+
+        auto& item = m_slots[m_head];
+        std::swap(m_inflight.value, item.value); // swap to keep the allocated capacity in circulation
+        m_inflight.targets    = item.targets;
+        m_inflight.numTargets = item.numTargets;
+        m_inflight.nextTarget = item.nextTarget;
+        m_inflight.rc         = item.rc;
+        m_inflight.cb         = std::move(item.cb);
+        m_head                = (m_head + 1) % m_slots.size();
+        m_count--;
+        m_hasInflight = true;
+        return true;
+    }
+
+    /** @brief Release the in-flight slot once its value has been sent to all targets. */
+    void finishInflight() {
+        NimBLEMutexGuard g(m_mutex);
+        m_hasInflight = false;
+    }
+
+    /** @brief Get the number of values waiting, including one that is partially sent. */
+    size_t count() const {
+        NimBLEMutexGuard g(m_mutex);
+        return m_count + (m_hasInflight ? 1 : 0);
+    }
+
+    /**
+     * @brief Queue a completion to be reported by the drain on the host task.
+     * @return True if the completion was queued.
+     */
+    bool addCompletion(NotifyCompleteCallback& cb, int rc) {
+        NimBLEMutexGuard g(m_mutex);
+        if (!g) {
+            return false;
+        }
+
+        m_completions.emplace_back(std::move(cb), rc);
+        return true;
+    }
+
+    /** @brief Move the completions waiting to be reported into out. */
+    void takeCompletions(std::vector<std::pair<NotifyCompleteCallback, int>>& out) {
+        NimBLEMutexGuard g(m_mutex);
+        if (g) {
+            out.swap(m_completions);
+        }
+    }
+
+    /** @brief Check if there are values waiting to be sent or completions waiting to be reported. */
+    bool pending() const {
+        NimBLEMutexGuard g(m_mutex);
+        return m_count > 0 || m_hasInflight || !m_completions.empty();
+    }
+
+    std::vector<Item>                                   m_slots;
+    std::vector<std::pair<NotifyCompleteCallback, int>> m_completions{};
+    Item                                                m_inflight{};
+    size_t                                              m_head{0};
+    size_t                                              m_count{0};
+    NotifyQueuePolicy                                   m_policy;
+    bool                                                m_hasInflight{false};
+    bool                                                m_valid{false};
+    mutable ble_npl_mutex                               m_mutex{};
+    ble_npl_event                                       m_drainEvent{};
+    ble_npl_callout                                     m_retryTimer{};
+    ble_npl_event                                       m_deleteEvent{};
+}; // NotifyQueue
+
+/**
+ * @brief Latest value wins notification state, flushed from the NimBLE host task.
+ */
+struct NimBLECharacteristic::Coalescer {
+    /** @brief Send state of a connection that has a value waiting. */
+    struct Peer {
+        uint16_t       connHandle{BLE_HS_CONN_HANDLE_NONE};
+        ble_npl_time_t lastSent{0};
+        bool           hasSent{false};
+        bool           dirty{false};
+    };
+
+    /** @brief Construct a Coalescer with the specified minimum period between notifications. */
+    Coalescer(NimBLECharacteristic* pChr, uint32_t periodMs) : m_period(ble_npl_time_ms_to_ticks32(periodMs)) {
+        ble_npl_event_init(&m_deleteEvent, deleteEventCb<Coalescer>, this);
+        memset(&m_mutex, 0, sizeof(m_mutex));
+        if (ble_npl_mutex_init(&m_mutex) != BLE_NPL_OK) {
+            NIMBLE_LOGE(LOG_TAG, "Failed to initialize coalescing mutex");
+            return;
+        }
+
+        if (ble_npl_callout_init(&m_timer, nimble_port_get_dflt_eventq(), NimBLECharacteristic::coalesceEventCb, pChr) !=
+            0) {
+            NIMBLE_LOGE(LOG_TAG, "Failed to initialize coalescing callout");
+            ble_npl_mutex_deinit(&m_mutex);
+            return;
+        }
+
+        ble_npl_event_init(&m_flushEvent, NimBLECharacteristic::coalesceEventCb, pChr);
+        m_valid = true;
+    }
+
+    /** @brief Destroy the Coalescer and release resources. */
+    ~Coalescer() {
+        ble_npl_eventq_remove(nimble_port_get_dflt_eventq(), &m_deleteEvent);
+        ble_npl_event_deinit(&m_deleteEvent);
+        if (!m_valid) {
+            return;
+        }
+
+        cancel();
+        ble_npl_callout_deinit(&m_timer);
+        ble_npl_event_deinit(&m_flushEvent);
+        ble_npl_mutex_deinit(&m_mutex);
+    }
+
+    /** @brief Stop the flush events, they reference the characteristic. */
+    void cancel() {
+        if (m_valid) {
+            ble_npl_callout_stop(&m_timer);
+            ble_npl_eventq_remove(nimble_port_get_dflt_eventq(), &m_flushEvent);
+        }
+    }
+
+    /**
+     * @brief Record a new value for the given connections, replacing any value not yet sent.
+     * @return True if the value was recorded.
+     */
+    bool update(const uint8_t* value, size_t length, const TargetArray& targets, size_t numTargets) {
+        NimBLEMutexGuard g(m_mutex);
+        if (!g) {
+            return false;
+        }
+
+        m_value.assign(value, value + length);
+        for (size_t i = 0; i < numTargets; i++) {
+            Peer* pPeer = find(targets[i]);
+            if (!pPeer) {
+                pPeer = find(BLE_HS_CONN_HANDLE_NONE);
+                for (size_t j = 0; !pPeer && j < m_peers.size(); j++) {
+                    if (!m_peers[j].dirty) {
+                        pPeer = &m_peers[j]; // reuse the slot of a connection that is idle or has closed
+                    }
+                }
+
+                if (!pPeer) {
+                    continue;
+                }
+
+                *pPeer            = Peer{};
+                pPeer->connHandle = targets[i];
+            }
+
+            pPeer->dirty = true;
+        }
+
+        return true;
+    }
+
+    /** @brief Find the state of a connection, BLE_HS_CONN_HANDLE_NONE finds a free slot. */
+    Peer* find(uint16_t connHandle) {
+        for (auto& peer : m_peers) {
+            if (peer.connHandle == connHandle) {
+                return &peer;
+            }
+        }
+        return nullptr;
+    }
+
+    /** @brief Check if any connection has a value waiting. */
+    bool pending() const {
+        NimBLEMutexGuard g(m_mutex);
+        for (const auto& peer : m_peers) {
+            if (peer.dirty) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::vector<uint8_t>                              m_value{};
+    std::vector<uint8_t>                              m_sendValue{}; // copy being sent, used only by the host task
+    std::array<Peer, MYNEWT_VAL(BLE_MAX_CONNECTIONS)> m_peers{};
+    ble_npl_time_t                                    m_period;
+    bool                                              m_valid{false};
+    mutable ble_npl_mutex                             m_mutex{};
+    ble_npl_event                                     m_flushEvent{};
+    ble_npl_callout                                   m_timer{};
+    ble_npl_event                                     m_deleteEvent{};
+}; // Coalescer
+
+/**
+ * @brief Values kept separately for each connection, indexed by the connection slot of the server.
+ */
+struct NimBLECharacteristic::PeerValues {
+    /** @brief The value of one connection, connHandle is BLE_HS_CONN_HANDLE_NONE while the slot is unused. */
+    struct Slot {
+        uint16_t       connHandle{BLE_HS_CONN_HANDLE_NONE};
+        NimBLEAttValue value;
+    };
+
+    /** @brief Construct the slots with the maximum length of the characteristic value. */
+    PeerValues(NimBLECharacteristic* pChr, uint16_t maxLen) : m_pChr(pChr), m_maxLen(maxLen) {
+        ble_npl_event_init(&m_linkEvent, PeerValues::linkEventCb, this);
+        ble_npl_event_init(&m_deleteEvent, deleteEventCb<PeerValues>, this);
+        for (auto& slot : m_slots) {
+            slot.value = NimBLEAttValue(uint16_t{0}, maxLen);
+        }
+    }
+
+    /** @brief Remove the characteristic from the list the server clears on disconnect. */
+    ~PeerValues() {
+        ble_npl_eventq_remove(nimble_port_get_dflt_eventq(), &m_linkEvent);
+        ble_npl_event_deinit(&m_linkEvent);
+        ble_npl_eventq_remove(nimble_port_get_dflt_eventq(), &m_deleteEvent);
+        ble_npl_event_deinit(&m_deleteEvent);
+
+        NimBLEServer* pServer = NimBLEDevice::getServer();
+        if (pServer) {
+            auto& chrs = pServer->m_peerValueChrs;
+            chrs.erase(std::remove(chrs.begin(), chrs.end(), m_pChr), chrs.end());
+        }
+    }
+
+    /**
+     * @brief Add the characteristic to the list the server clears on disconnect.
+     * @details Done on the host task, where the list is iterated. Slots set for connections that closed
+     * before this ran are released.
+     */
+    void link() {
+        NimBLEServer* pServer = NimBLEDevice::getServer();
+        if (!pServer) {
+            return;
+        }
+
+        pServer->m_peerValueChrs.push_back(m_pChr);
+        for (auto& slot : m_slots) {
+            if (slot.connHandle != BLE_HS_CONN_HANDLE_NONE && pServer->getConnIndex(slot.connHandle) < 0) {
+                slot.connHandle = BLE_HS_CONN_HANDLE_NONE;
+                slot.value      = NimBLEAttValue(uint16_t{0}, m_maxLen);
+            }
+        }
+    }
+
+    /** @brief Event callback that links the values on the host task. */
+    static void linkEventCb(struct ble_npl_event* ev) { static_cast<PeerValues*>(ble_npl_event_get_arg(ev))->link(); }
+
+    /** @brief Get the slot of a connection, or nullptr if the server does not track it. */
+    Slot* find(uint16_t connHandle) {
+        NimBLEServer* pServer = NimBLEDevice::getServer();
+        int           index   = pServer ? pServer->getConnIndex(connHandle) : -1;
+        return index < 0 ? nullptr : &m_slots[index];
+    }
+
+    std::array<Slot, MYNEWT_VAL(BLE_MAX_CONNECTIONS)> m_slots{};
+    NimBLECharacteristic*                             m_pChr;
+    uint16_t                                          m_maxLen;
+    ble_npl_event                                     m_linkEvent{};
+    ble_npl_event                                     m_deleteEvent{};
+}; // PeerValues
+
+/**
+ * @brief Ring buffer of client writes, filled by the NimBLE host task and drained by the application.
+ * @details Each write is stored as a record of a 4 byte header, the little endian length and connection handle,
+ * followed by the data. Records wrap around the end of the buffer.
+ */
+struct NimBLECharacteristic::WriteRing {
+    static constexpr size_t HEADER_LEN = 4;
+
+    /** @brief Construct a WriteRing of the specified size in bytes. */
+    WriteRing(size_t size, WriteRingPolicy policy, WriteRingCallback cb)
+        : m_buf(size), m_policy(policy), m_cb(std::move(cb)) {
+        ble_npl_event_init(&m_deleteEvent, deleteEventCb<WriteRing>, this);
+        memset(&m_mutex, 0, sizeof(m_mutex));
+        if (ble_npl_mutex_init(&m_mutex) != BLE_NPL_OK) {
+            NIMBLE_LOGE(LOG_TAG, "Failed to initialize write ring mutex");
+            return;
+        }
+
+        m_valid = true;
+    }
+
+    /** @brief Destroy the WriteRing and release resources. */
+    ~WriteRing() {
+        ble_npl_eventq_remove(nimble_port_get_dflt_eventq(), &m_deleteEvent);
+        ble_npl_event_deinit(&m_deleteEvent);
+        if (m_valid) {
+            ble_npl_mutex_deinit(&m_mutex);
+        }
+    }
+
+    /** @brief Copy bytes out of the ring starting at pos, wrapping at the end of the buffer. */
+    void copyOut(size_t pos, uint8_t* dst, size_t len) const {
+        const size_t first = std::min(len, m_buf.size() - pos);
+        memcpy(dst, &m_buf[pos], first);
+        memcpy(dst + first, &m_buf[0], len - first);
+    }
+
+    /** @brief Get the total length of the record at pos. */
+    size_t recordLen(size_t pos) const {
+        uint8_t hdr[2];
+        copyOut(pos, hdr, sizeof(hdr));
+        return HEADER_LEN + (hdr[0] | (hdr[1] << 8));
+    }
+
+    /**
+     * @brief Store a write at the back of the ring.
+     * @param [out] wasEmpty Set to true if the ring was empty before the write was stored.
+     * @return True if the write was stored, false if it was dropped.
+     */
+    bool push(const os_mbuf* om, uint16_t len, uint16_t connHandle, bool& wasEmpty) {
+        NimBLEMutexGuard g(m_mutex);
+        if (!g) {
+            return false;
+        }
+
+        const size_t size   = m_buf.size();
+        const size_t recLen = HEADER_LEN + len;
+        if (recLen > size) {
+            m_stats.dropped++;
+            return false;
+        }
+
+        while (size - m_used < recLen) {
+            if (m_policy == DROP_NEW_WRITE) {
+                m_stats.dropped++;
+                return false;
+            }
+
+            const size_t oldLen  = recordLen(m_tail);
+            m_tail               = (m_tail + oldLen) % size;
+            m_used              -= oldLen;
+            m_count--;
+            m_stats.dropped++;
+        }
+
+        wasEmpty = m_count == 0;
+
+        const size_t  head  = (m_tail + m_used) % size;
+        const uint8_t hdr[] = {static_cast<uint8_t>(len),
+                               static_cast<uint8_t>(len >> 8),
+                               static_cast<uint8_t>(connHandle),
+                               static_cast<uint8_t>(connHandle >> 8)};
+        for (size_t i = 0; i < HEADER_LEN; i++) {
+            m_buf[(head + i) % size] = hdr[i];
+        }
+
+        const size_t dataPos = (head + HEADER_LEN) % size;
+        const size_t first   = std::min<size_t>(len, size - dataPos);
+        os_mbuf_copydata(om, 0, first, &m_buf[dataPos]);
+        if (len > first) {
+            os_mbuf_copydata(om, first, len - first, &m_buf[0]);
+        }
+
+        m_used += recLen;
+        m_count++;
+        m_stats.received++;
+        if (m_used > m_stats.highWater) {
+            m_stats.highWater = m_used;
+        }
+
+        return true;
+    }
+
+    /**
+     * @brief Move as many whole records as fit into the buffer, oldest first.
+     * @return The number of records read.
+     */
+    size_t read(uint8_t* buf, size_t bufLen, WriteRecord* records, size_t maxRecords) {
+        NimBLEMutexGuard g(m_mutex);
+        if (!g) {
+            return 0;
+        }
+
+        size_t numRead = 0;
+        size_t offset  = 0;
+        while (numRead < maxRecords && numRead < m_count) {
+            const size_t recLen = recordLen(m_tail);
+            if (offset + recLen > bufLen) {
+                break;
+            }
+
+            uint8_t* rec = buf + offset;
+            copyOut(m_tail, rec, recLen);
+            records[numRead].data       = rec + HEADER_LEN;
+            records[numRead].length     = rec[0] | (rec[1] << 8);
+            records[numRead].connHandle = rec[2] | (rec[3] << 8);
+            m_tail                      = (m_tail + recLen) % m_buf.size();
+            m_used                     -= recLen;
+            offset                     += recLen;
+            numRead++;
+        }
+
+        m_count -= numRead;
+        return numRead;
+    }
+
+    std::vector<uint8_t> m_buf;
+    size_t               m_tail{0};
+    size_t               m_used{0};
+    size_t               m_count{0};
+    WriteRingPolicy      m_policy;
+    WriteRingCallback    m_cb;
+    WriteRingStats       m_stats{};
+    bool                 m_valid{false};
+    ble_npl_mutex        m_mutex{};
+    ble_npl_event        m_deleteEvent{};
+}; // WriteRing
+
 /**
  * @brief Construct a characteristic
  * @param [in] uuid - UUID (const char*) for the characteristic.
@@ -61,6 +608,35 @@ NimBLECharacteristic::~NimBLECharacteristic() {
     for (const auto& dsc : m_vDescriptors) {
         delete dsc;
     }
+
+    // Host task handlers use these without a lock, unlink them and delete them once those have returned.
+    // Their pending events reference this characteristic and are cancelled first.
+    NotifyQueue* pQueue = m_pNotifyQueue;
+    m_pNotifyQueue      = nullptr;
+    if (pQueue) {
+        pQueue->cancel();
+        deleteOnHostTask(pQueue);
+    }
+
+    Coalescer* pCoalescer = m_pCoalescer;
+    m_pCoalescer          = nullptr;
+    if (pCoalescer) {
+        pCoalescer->cancel();
+        deleteOnHostTask(pCoalescer);
+    }
+
+    PeerValues* pPeerValues = m_pPeerValues;
+    m_pPeerValues           = nullptr;
+    deleteOnHostTask(pPeerValues);
+
+    WriteRing* pWriteRing = m_pWriteRing;
+    m_pWriteRing          = nullptr;
+    deleteOnHostTask(pWriteRing);
+
+    NimBLEServer* pServer = NimBLEDevice::getServer();
+    if (pServer) {
+        pServer->flushIndications(BLE_HS_CONN_HANDLE_NONE, this, BLE_HS_ENOENT);
+    }
 } // ~NimBLECharacteristic
 
 /**
@@ -231,6 +807,12 @@ void NimBLECharacteristic::setService(NimBLEService* pService) {
  * @return True if the indication was sent successfully, false otherwise.
  */
 bool NimBLECharacteristic::indicate(uint16_t connHandle) const {
+    if (m_pPeerValues) {
+        return sendPeerValues(connHandle, [this](const NimBLEAttValue& v, uint16_t conn) {
+            return sendValue(v.data(), v.size(), false, conn);
+        });
+    }
+
     auto value{m_value}; // make a copy to avoid issues if the value is changed while indicating
     return sendValue(value.data(), value.size(), false, connHandle);
 } // indicate
@@ -247,6 +829,49 @@ bool NimBLECharacteristic::indicate(const uint8_t* value, size_t length, uint16_
     return sendValue(value, length, false, connHandle);
 } // indicate
 
+/**
+ * @brief Queue an indication of the current value without blocking.
+ * @param[in] connHandle Connection handle to send an individual indication, or BLE_HS_CONN_HANDLE_NONE to send
+ * the indication to all subscribed clients.
+ * @param[in] cb Optional callback invoked from the NimBLE host task for each connection once the indication
+ * has been confirmed, has failed or has timed out.
+ * @return True if the indication was queued for all target connections.
+ */
+bool NimBLECharacteristic::indicateAsync(uint16_t connHandle, IndicateCompleteCallback cb) {
+    if (m_pPeerValues) {
+        return sendPeerValues(connHandle, [this, &cb](const NimBLEAttValue& v, uint16_t conn) {
+            return indicateAsync(v.data(), v.size(), conn, cb);
+        });
+    }
+
+    auto value{m_value}; // make a copy to avoid issues if the value is changed while queuing
+    return indicateAsync(value.data(), value.size(), connHandle, std::move(cb));
+} // indicateAsync
+
+/**
+ * @brief Queue an indication without blocking.
+ * @param[in] value A pointer to the data to send.
+ * @param[in] length The length of the data to send.
+ * @param[in] connHandle Connection handle to send an individual indication, or BLE_HS_CONN_HANDLE_NONE to send
+ * the indication to all subscribed clients.
+ * @param[in] cb Optional callback invoked from the NimBLE host task for each connection once the indication
+ * has been confirmed, has failed or has timed out.
+ * @return True if the indication was queued for all target connections.
+ * @details The indication is placed in the per connection queue of the server and sent once the previous
+ * indication on that connection has been confirmed, see NimBLEServer::queueIndication.
+ */
+bool NimBLECharacteristic::indicateAsync(const uint8_t*           value,
+                                         size_t                   length,
+                                         uint16_t                 connHandle,
+                                         IndicateCompleteCallback cb) {
+    NimBLEServer* pServer = NimBLEDevice::getServer();
+    if (!pServer) {
+        return false;
+    }
+
+    return pServer->queueIndication(this, value, length, connHandle, std::move(cb));
+} // indicateAsync
+
 /**
  * @brief Send a notification.
  * @param[in] connHandle Connection handle to send an individual notification, or BLE_HS_CONN_HANDLE_NONE to send
@@ -254,6 +879,12 @@ bool NimBLECharacteristic::indicate(const uint8_t* value, size_t length, uint16_
  * @return True if the notification was sent successfully, false otherwise.
  */
 bool NimBLECharacteristic::notify(uint16_t connHandle) const {
+    if (m_pPeerValues) {
+        return sendPeerValues(connHandle, [this](const NimBLEAttValue& v, uint16_t conn) {
+            return sendValue(v.data(), v.size(), true, conn);
+        });
+    }
+
     auto value{m_value}; // make a copy to avoid issues if the value is changed while notifying
     return sendValue(value.data(), value.size(), true, connHandle);
 } // notify
@@ -277,17 +908,82 @@ bool NimBLECharacteristic::notify(const uint8_t* value, size_t length, uint16_t
  * @param[in] isNotification if true sends a notification, false sends an indication.
  * @param[in] connHandle Connection handle to send to a specific peer.
  * @return True if the value was sent successfully, false otherwise.
+ * @details When notification coalescing is enabled notifications are recorded and sent later from the host task.
  */
 bool NimBLECharacteristic::sendValue(const uint8_t* value, size_t length, bool isNotification, uint16_t connHandle) const {
+    TargetArray targets{};
+    size_t      numTargets = getSendTargets(connHandle, targets);
+    if (numTargets == 0) {
+        if (connHandle != BLE_HS_CONN_HANDLE_NONE) {
+            NIMBLE_LOGE(LOG_TAG,
+                        "failed to send value, rc=%d %s",
+                        BLE_HS_ENOENT,
+                        NimBLEUtils::returnCodeToString(BLE_HS_ENOENT));
+            return false;
+        }
+
+        return true;
+    }
+
+    if (isNotification && m_pCoalescer) {
+        if (!m_pCoalescer->update(value, length, targets, numTargets)) {
+            return false;
+        }
+
+        ble_npl_eventq_put(nimble_port_get_dflt_eventq(), &m_pCoalescer->m_flushEvent);
+        return true;
+    }
+
+    // Keep indications sent here apart from the ones of the indication queue on the same connection.
+    NimBLEServer* pServer = isNotification ? nullptr : NimBLEDevice::getServer();
+    bool          busy    = false;
+    if (pServer) {
+        size_t numFree = 0;
+        for (size_t i = 0; i < numTargets; i++) {
+            if (pServer->beginDirectIndication(targets[i])) {
+                targets[numFree++] = targets[i];
+            } else {
+                NIMBLE_LOGW(LOG_TAG, "indication queued on connHandle=%d is outstanding, skipped", targets[i]);
+                busy = true;
+            }
+        }
+        numTargets = numFree;
+    }
+
+    size_t numSent = 0;
+    int    rc      = 0;
+    if (numTargets) {
+        rc = sendToTargets(value, length, isNotification, targets.data(), numTargets, &numSent, true);
+    }
+    if (pServer) {
+        for (size_t i = numSent; i < numTargets; i++) {
+            pServer->endDirectIndication(targets[i]);
+        }
+    }
+
+    if (rc != 0) {
+        NIMBLE_LOGE(LOG_TAG, "failed to send value, rc=%d %s", rc, NimBLEUtils::returnCodeToString(rc));
+        return false;
+    }
+
+    return !busy;
+} // sendValue
+
+/**
+ * @brief Get the connections a value should be sent to.
+ * @param[in] connHandle Connection handle of a specific peer, or BLE_HS_CONN_HANDLE_NONE for all subscribers.
+ * @param[out] targets The array to fill with the connection handles.
+ * @return The number of connection handles written to targets.
+ * @details Peers that have not secured the link are skipped if the characteristic requires security to read.
+ */
+size_t NimBLECharacteristic::getSendTargets(uint16_t connHandle, TargetArray& targets) const {
     ble_npl_hw_enter_critical();
     const auto subs = getSubscribers(); // make a copy to avoid issues if subscribers change while sending
     ble_npl_hw_exit_critical(0);
 
-    bool chSpecified = connHandle != BLE_HS_CONN_HANDLE_NONE;
-    bool requireSecure = m_properties & (BLE_GATT_CHR_F_READ_ENC | BLE_GATT_CHR_F_READ_AUTHEN | BLE_GATT_CHR_F_READ_AUTHOR);
-    int rc = chSpecified ? BLE_HS_ENOENT : 0; // if handle specified, assume not found until sent
-
-    // Notify all connected peers unless a specific handle is provided
+    bool   chSpecified   = connHandle != BLE_HS_CONN_HANDLE_NONE;
+    bool   requireSecure = m_properties & (BLE_GATT_CHR_F_READ_ENC | BLE_GATT_CHR_F_READ_AUTHEN | BLE_GATT_CHR_F_READ_AUTHOR);
+    size_t numTargets    = 0;
     for (const auto& entry : subs) {
         uint16_t ch = entry.getConnHandle();
         if (ch == BLE_HS_CONN_HANDLE_NONE || (chSpecified && ch != connHandle)) {
@@ -299,37 +995,723 @@ bool NimBLECharacteristic::sendValue(const uint8_t* value, size_t length, bool i
             continue;
         }
 
-        // Must re-create the data buffer on each iteration because it is freed by the calls below.
-        uint8_t  retries = 10; // wait up to 10ms for a free buffer
-        os_mbuf* om      = ble_hs_mbuf_from_flat(value, length);
-        while (!om && --retries) {
-            ble_npl_time_delay(ble_npl_time_ms_to_ticks32(1));
-            om = ble_hs_mbuf_from_flat(value, length);
+        targets[numTargets++] = ch;
+        if (chSpecified) {
+            break;
         }
+    }
 
-        if (!om) {
-            rc = BLE_HS_ENOMEM;
-            break;
+    return numTargets;
+} // getSendTargets
+
+/**
+ * @brief Send a value to a list of connections, building the payload only once.
+ * @param[in] value A pointer to the data to send.
+ * @param[in] length The length of the data to send.
+ * @param[in] isNotification if true sends a notification, false sends an indication.
+ * @param[in] targets The connection handles to send to.
+ * @param[in] numTargets The number of connection handles in targets.
+ * @param[out] numSent The number of targets the value was handed to the stack for.
+ * @param[in] wait If true, wait up to 10ms for a free buffer before giving up.
+ * @return 0 if the value was sent to all targets, otherwise the error for the target at index numSent.
+ */
+int NimBLECharacteristic::sendToTargets(const uint8_t*  value,
+                                        size_t          length,
+                                        bool            isNotification,
+                                        const uint16_t* targets,
+                                        size_t          numTargets,
+                                        size_t*         numSent,
+                                        bool            wait) const {
+    return sendToTargets(m_handle, value, length, isNotification, targets, numTargets, numSent, wait);
+} // sendToTargets
+
+/**
+ * @brief Send the value of a characteristic by handle, for callers that must not touch the characteristic.
+ * @param[in] attrHandle The handle of the characteristic value.
+ * @details See the member overload for the other parameters.
+ */
+int NimBLECharacteristic::sendToTargets(uint16_t        attrHandle,
+                                        const uint8_t*  value,
+                                        size_t          length,
+                                        bool            isNotification,
+                                        const uint16_t* targets,
+                                        size_t          numTargets,
+                                        size_t*         numSent,
+                                        bool            wait) {
+    NimBLEServer* pServer = NimBLEDevice::getServer();
+    uint8_t       retries = wait ? 10 : 1; // wait up to 10ms for a free buffer
+    os_mbuf*      om      = ble_hs_mbuf_from_flat(value, length);
+    while (!om && --retries) {
+        ble_npl_time_delay(ble_npl_time_ms_to_ticks32(1));
+        om = ble_hs_mbuf_from_flat(value, length);
+    }
+
+    *numSent = 0;
+    if (!om) {
+        if (pServer) {
+            pServer->m_txStats.mbufAllocFail++;
+        }
+
+        return BLE_HS_ENOMEM;
+    }
+
+    if (pServer) {
+        // Every peer except the last needs its own copy of the payload chain, check the pool can supply them.
+        uint16_t freeBlocks = os_msys_num_free();
+        if (freeBlocks < pServer->m_txStats.mbufFreeMin) {
+            pServer->m_txStats.mbufFreeMin = freeBlocks;
+        }
+
+        if (numTargets > 1) {
+            size_t chainBlocks = 0;
+            for (const os_mbuf* m = om; m != nullptr; m = SLIST_NEXT(m, om_next)) {
+                chainBlocks++;
+            }
+
+            size_t needed = chainBlocks * (numTargets - 1);
+            if (freeBlocks < needed) {
+                pServer->m_txStats.mbufPressure++;
+                NIMBLE_LOGW(LOG_TAG,
+                            "mbuf pool pressure: %u blocks free, %u needed for %u peers",
+                            (unsigned)freeBlocks,
+                            (unsigned)needed,
+                            (unsigned)numTargets);
+            }
+        }
+    }
+
+    int rc = 0;
+    for (size_t i = 0; i < numTargets; i++) {
+        // The stack consumes the mbuf it is given, the last peer takes the original and the others get a duplicate.
+        bool     last = (i == numTargets - 1);
+        os_mbuf* txom = om;
+        if (!last) {
+            retries = wait ? 10 : 1;
+            txom    = os_mbuf_dup(om);
+            while (!txom && --retries) {
+                ble_npl_time_delay(ble_npl_time_ms_to_ticks32(1));
+                txom = os_mbuf_dup(om);
+            }
+
+            if (!txom) {
+                if (pServer) {
+                    pServer->m_txStats.mbufAllocFail++;
+                }
+
+                os_mbuf_free_chain(om);
+                return BLE_HS_ENOMEM;
+            }
         }
 
         if (isNotification) {
-            rc = ble_gatts_notify_custom(ch, m_handle, om);
+            rc = ble_gatts_notify_custom(targets[i], attrHandle, txom);
         } else {
-            rc = ble_gatts_indicate_custom(ch, m_handle, om);
+            rc = ble_gatts_indicate_custom(targets[i], attrHandle, txom);
+        }
+
+        if (pServer) {
+            rc == 0 ? pServer->m_txStats.sent++ : pServer->m_txStats.failed++;
         }
 
-        if (rc != 0 || chSpecified) {
+        if (rc != 0) {
+            if (!last) {
+                os_mbuf_free_chain(om);
+            }
             break;
         }
+
+        (*numSent)++;
     }
 
-    if (rc != 0) {
-        NIMBLE_LOGE(LOG_TAG, "failed to send value, rc=%d %s", rc, NimBLEUtils::returnCodeToString(rc));
+    return rc;
+} // sendToTargets
+
+/**
+ * @brief Configure the outbound notification queue used by notifyAsync.
+ * @param[in] depth The maximum number of values that can be queued, 0 removes the queue.
+ * @param[in] policy The action to take when a value is queued while the queue is full.
+ * @return True if the queue was configured, false if values are still queued or on allocation failure.
+ * @details If not called, the queue is created on first use with a depth of
+ * CONFIG_NIMBLE_CPP_NOTIFY_QUEUE_DEFAULT_DEPTH and the DROP_NEW policy.
+ * The previous queue is deleted on the host task once the drain using it has returned, this must not be
+ * called concurrently with notifyAsync from another task.
+ */
+bool NimBLECharacteristic::setNotifyQueue(uint8_t depth, NotifyQueuePolicy policy) {
+    NotifyQueue* pNew = nullptr;
+    if (depth > 0) {
+        pNew = new (std::nothrow) NotifyQueue(this, depth, policy);
+        if (!pNew || !pNew->m_valid) {
+            NIMBLE_LOGE(LOG_TAG, "Failed to create notify queue");
+            delete pNew;
+            return false;
+        }
+    }
+
+    NotifyQueue* pOld = m_pNotifyQueue;
+    if (pOld) {
+        NimBLEMutexGuard g(pOld->m_mutex);
+        if (pOld->m_count > 0 || pOld->m_hasInflight || !pOld->m_completions.empty()) {
+            NIMBLE_LOGW(LOG_TAG, "Cannot change notify queue while values are pending");
+            delete pNew;
+            return false;
+        }
+    }
+
+    m_pNotifyQueue = pNew;
+    deleteOnHostTask(pOld);
+    return true;
+} // setNotifyQueue
+
+/**
+ * @brief Get the number of values waiting in the notification queue.
+ * @return The number of queued values, including one that is partially sent.
+ */
+size_t NimBLECharacteristic::getNotifyQueueCount() const {
+    NotifyQueue* q = m_pNotifyQueue;
+    return q ? q->count() : 0;
+} // getNotifyQueueCount
+
+/**
+ * @brief Enable or disable latest value wins notification coalescing.
+ * @param[in] periodMs The minimum time between notifications to each connection in milliseconds,
+ * 0 disables coalescing and discards any values not yet sent.
+ * @return True on success, false if the coalescing resources could not be allocated.
+ * @details While enabled, notify() only records the value and returns, a value that has not been sent yet is
+ * replaced by the newer one. The latest value is sent to each subscriber from the NimBLE host task no more
+ * than once per period, retrying when a transmit completes if the stack was out of buffers.
+ * Indications are not affected. Disabling deletes the coalescing state on the host task once a flush using it
+ * has returned, this must not be called concurrently with notify() from another task.
+ */
+bool NimBLECharacteristic::setNotifyCoalescing(uint32_t periodMs) {
+    if (periodMs == 0) {
+        Coalescer* pOld = m_pCoalescer;
+        m_pCoalescer    = nullptr;
+        deleteOnHostTask(pOld);
+        return true;
+    }
+
+    if (m_pCoalescer) {
+        NimBLEMutexGuard g(m_pCoalescer->m_mutex);
+        m_pCoalescer->m_period = ble_npl_time_ms_to_ticks32(periodMs);
+        return true;
+    }
+
+    Coalescer* pNew = new (std::nothrow) Coalescer(this, periodMs);
+    if (!pNew || !pNew->m_valid) {
+        NIMBLE_LOGE(LOG_TAG, "Failed to create notification coalescer");
+        delete pNew;
         return false;
     }
 
+    m_pCoalescer = pNew;
     return true;
-} // sendValue
+} // setNotifyCoalescing
+
+/**
+ * @brief Event callback to send coalesced notifications.
+ * @param[in] ev Pointer to the event that triggered the callback.
+ */
+void NimBLECharacteristic::coalesceEventCb(struct ble_npl_event* ev) {
+    auto* pChr = static_cast<NimBLECharacteristic*>(ble_npl_event_get_arg(ev));
+    if (pChr) {
+        pChr->flushCoalesced();
+    }
+} // coalesceEventCb
+
+/**
+ * @brief Send the latest value to every connection that has one waiting and whose period has elapsed.
+ * @details Called only from the NimBLE host task. Connections that are still inside their period are
+ * handled by a callout at the earliest time one becomes due, connections that fail for any reason
+ * other than a lack of buffers are forgotten.
+ */
+void NimBLECharacteristic::flushCoalesced() {
+    Coalescer* c = m_pCoalescer;
+    if (!c) {
+        return;
+    }
+
+    ble_npl_time_t now = ble_npl_time_get();
+    ble_npl_time_t wait{0};
+    TargetArray    targets{};
+    size_t         numTargets = 0;
+    {
+        // Take the due connections and a copy of the value, the lock is not held while sending
+        // so that notify() callers never wait for the stack.
+        NimBLEMutexGuard g(c->m_mutex);
+        if (!g) {
+            return;
+        }
+
+        for (auto& peer : c->m_peers) {
+            if (!peer.dirty) {
+                continue;
+            }
+
+            ble_npl_time_t elapsed = now - peer.lastSent;
+            if (peer.hasSent && elapsed < c->m_period) {
+                ble_npl_time_t remaining = c->m_period - elapsed;
+                if (wait == 0 || remaining < wait) {
+                    wait = remaining;
+                }
+                continue;
+            }
+
+            peer.dirty            = false; // set again by update() if a newer value arrives while sending
+            targets[numTargets++] = peer.connHandle;
+        }
+
+        if (numTargets > 0) {
+            c->m_sendValue.assign(c->m_value.begin(), c->m_value.end());
+        }
+    }
+
+    size_t      next      = 0;
+    size_t      numFailed = 0;
+    TargetArray failed{};
+    while (next < numTargets) {
+        size_t numSent = 0;
+        int    rc      = sendToTargets(c->m_sendValue.data(),
+                                c->m_sendValue.size(),
+                                true,
+                                &targets[next],
+                                numTargets - next,
+                                &numSent,
+                                false);
+        next += numSent;
+        if (rc == 0 || rc == BLE_HS_ENOMEM) {
+            break;
+        }
+
+        failed[numFailed++] = targets[next]; // failed for a reason other than buffers, forget the connection
+        next++;
+    }
+
+    if (numTargets > 0) {
+        NimBLEMutexGuard g(c->m_mutex);
+        const auto failedEnd = failed.begin() + numFailed;
+        for (size_t i = 0; i < numTargets; i++) {
+            Coalescer::Peer* pPeer = c->find(targets[i]);
+            if (!pPeer) {
+                continue;
+            }
+
+            if (i >= next) {
+                pPeer->dirty = true; // out of buffers, retry
+            } else if (std::find(failed.begin(), failedEnd, targets[i]) != failedEnd) {
+                *pPeer = Coalescer::Peer{};
+            } else {
+                pPeer->hasSent  = true;
+                pPeer->lastSent = now;
+            }
+        }
+    }
+
+    if (next < numTargets) {
+        // Resumed when a transmit completes, retry after a while in case none does.
+        ble_npl_time_t retry = ble_npl_time_ms_to_ticks32(MYNEWT_VAL(NIMBLE_CPP_NOTIFY_RETRY_MS));
+        retry                = retry > 0 ? retry : 1;
+        if (wait == 0 || retry < wait) {
+            wait = retry;
+        }
+    }
+
+    if (wait > 0) {
+        ble_npl_callout_reset(&c->m_timer, wait);
+    }
+} // flushCoalesced
+
+/**
+ * @brief Enable or disable chunked write handling.
+ * @param [in] enable If true, data written by a client is delivered to NimBLECharacteristicCallbacks::onWriteChunk
+ * directly from the stack buffers and is not stored in the characteristic value.
+ * @details This avoids copying the written data for write heavy characteristics such as firmware or log uploads.
+ * When enabled NimBLECharacteristicCallbacks::onWrite is not called and getValue() does not reflect client writes.
+ */
+void NimBLECharacteristic::setChunkedWrite(bool enable) {
+    m_chunkedWrite = enable;
+} // setChunkedWrite
+
+/**
+ * @brief Check if chunked write handling is enabled.
+ * @return True if client writes are delivered to NimBLECharacteristicCallbacks::onWriteChunk.
+ */
+bool NimBLECharacteristic::isChunkedWrite() const {
+    return m_chunkedWrite;
+} // isChunkedWrite
+
+/**
+ * @brief Store client writes in a ring buffer to be read by the application instead of calling onWrite.
+ * @param [in] size The size of the ring in bytes, each write uses its length plus a 4 byte header.
+ * 0 disables the ring, any stored writes are discarded.
+ * @param [in] policy The action to take when a write does not fit in the ring.
+ * @param [in] cb Optional callback invoked from the NimBLE host task when a write is stored in an empty ring.
+ * @return True on success, false if the ring could not be allocated.
+ * @details Intended for write without response streams such as sensor uploads or logs: the host task only copies
+ * each write into the preallocated ring, the application drains the writes in batches with readWrites() from its
+ * own task, so processing time does not stall the stack. While enabled NimBLECharacteristicCallbacks::onWrite and
+ * onWriteChunk are not called and the characteristic value is not updated by client writes.
+ * A replaced ring is deleted on the host task once the write handler using it has returned, this must not be
+ * called concurrently with readWrites from another task.
+ */
+bool NimBLECharacteristic::setWriteRing(size_t size, WriteRingPolicy policy, WriteRingCallback cb) {
+    WriteRing* pNew = nullptr;
+    if (size > 0) {
+        pNew = new (std::nothrow) WriteRing(size, policy, std::move(cb));
+        if (!pNew || !pNew->m_valid) {
+            NIMBLE_LOGE(LOG_TAG, "Failed to create write ring");
+            delete pNew;
+            return false;
+        }
+    }
+
+    WriteRing* pOld = m_pWriteRing;
+    m_pWriteRing    = pNew;
+    deleteOnHostTask(pOld);
+    return true;
+} // setWriteRing
+
+/**
+ * @brief Read stored client writes from the write ring, oldest first.
+ * @param [out] buf The buffer to copy the writes into, it must be at least the maximum value length + 4 bytes.
+ * @param [in] bufLen The length of the buffer.
+ * @param [out] records Receives the length, connection handle and location in buf of each write read.
+ * @param [in] maxRecords The number of entries in records.
+ * @return The number of writes read, 0 if the ring is empty or not enabled.
+ * @details All writes that fit are copied in one call so that a consumer task can process them in batches.
+ */
+size_t NimBLECharacteristic::readWrites(uint8_t* buf, size_t bufLen, WriteRecord* records, size_t maxRecords) {
+    if (!m_pWriteRing || buf == nullptr || records == nullptr) {
+        return 0;
+    }
+
+    return m_pWriteRing->read(buf, bufLen, records, maxRecords);
+} // readWrites
+
+/**
+ * @brief Get the number of writes waiting in the write ring.
+ * @return The number of writes stored.
+ */
+size_t NimBLECharacteristic::getWriteRingCount() const {
+    if (!m_pWriteRing) {
+        return 0;
+    }
+
+    NimBLEMutexGuard g(m_pWriteRing->m_mutex);
+    return m_pWriteRing->m_count;
+} // getWriteRingCount
+
+/**
+ * @brief Get the write ring counters.
+ * @return A copy of the counters.
+ */
+NimBLECharacteristic::WriteRingStats NimBLECharacteristic::getWriteRingStats() const {
+    if (!m_pWriteRing) {
+        return WriteRingStats{};
+    }
+
+    NimBLEMutexGuard g(m_pWriteRing->m_mutex);
+    return m_pWriteRing->m_stats;
+} // getWriteRingStats
+
+/**
+ * @brief Reset the write ring counters.
+ */
+void NimBLECharacteristic::resetWriteRingStats() {
+    if (m_pWriteRing) {
+        NimBLEMutexGuard g(m_pWriteRing->m_mutex);
+        m_pWriteRing->m_stats = WriteRingStats{};
+    }
+} // resetWriteRingStats
+
+/**
+ * @brief Store a client write in the write ring.
+ * @param [in] om The mbuf chain holding the written data.
+ * @param [in] len The length of the written data.
+ * @param [in] connHandle The connection handle of the client.
+ * @return 0 if the write was stored, otherwise BLE_ATT_ERR_INSUFFICIENT_RES.
+ */
+int NimBLECharacteristic::ringWriteEvent(const os_mbuf* om, uint16_t len, uint16_t connHandle) {
+    WriteRing* pRing    = m_pWriteRing; // read once, the ring may be replaced from another task
+    bool       wasEmpty = false;
+    if (!pRing || !pRing->push(om, len, connHandle, wasEmpty)) {
+        return BLE_ATT_ERR_INSUFFICIENT_RES;
+    }
+
+    if (wasEmpty && pRing->m_cb) {
+        pRing->m_cb(this);
+    }
+
+    return 0;
+} // ringWriteEvent
+
+/**
+ * @brief Enable or disable separate values for each connection.
+ * @param [in] enable If true, each connected peer reads and writes its own copy of the value.
+ * @return True on success, false if the value storage could not be allocated.
+ * @details Useful for per-client protocol state such as session cursors or configuration, the value of a peer
+ * is found in O(1) by its connection slot and is released when it disconnects.\n
+ * While enabled:
+ * * Writes from a peer are stored in the value of that peer, use getPeerValue() in onWrite to read it.
+ * * Reads return the value of the peer, or the shared value if none has been set for it.
+ * * notify(), indicate(), notifyAsync() and indicateAsync() without a value send each peer its own value,
+ * the async completion callback is invoked for each peer.
+ *
+ * Disabling deletes the values on the host task once any handler using them has returned, this must not be
+ * called concurrently with the peer value functions from another task.
+ */
+bool NimBLECharacteristic::setPerConnectionValues(bool enable) {
+    if (!enable) {
+        PeerValues* pOld = m_pPeerValues;
+        m_pPeerValues    = nullptr;
+        deleteOnHostTask(pOld);
+        return true;
+    }
+
+    if (m_pPeerValues) {
+        return true;
+    }
+
+    PeerValues* pNew = new (std::nothrow) PeerValues(this, m_value.max_size());
+    if (!pNew) {
+        NIMBLE_LOGE(LOG_TAG, "Failed to allocate per connection values");
+        return false;
+    }
+
+    if (NimBLEDevice::isInitialized()) {
+        ble_npl_eventq_put(nimble_port_get_dflt_eventq(), &pNew->m_linkEvent);
+    } else {
+        pNew->link();
+    }
+
+    m_pPeerValues = pNew;
+    return true;
+} // setPerConnectionValues
+
+/**
+ * @brief Check if separate values for each connection are enabled.
+ * @return True if each connected peer has its own value.
+ */
+bool NimBLECharacteristic::isPerConnectionValues() const {
+    return m_pPeerValues != nullptr;
+} // isPerConnectionValues
+
+/**
+ * @brief Set the value of a connected peer.
+ * @param [in] connHandle The connection handle of the peer.
+ * @param [in] value A pointer to the data to set.
+ * @param [in] length The length of the data.
+ * @return True if the value was set, false if per connection values are disabled or the peer is not connected.
+ */
+bool NimBLECharacteristic::setPeerValue(uint16_t connHandle, const uint8_t* value, size_t length) {
+    PeerValues::Slot* pSlot = m_pPeerValues ? m_pPeerValues->find(connHandle) : nullptr;
+    if (!pSlot) {
+        return false;
+    }
+
+    pSlot->connHandle = connHandle;
+    return pSlot->value.setValue(value, length);
+} // setPeerValue
+
+/**
+ * @brief Get the value of a connected peer.
+ * @param [in] connHandle The connection handle of the peer.
+ * @return A copy of the value of the peer, or of the shared value if none has been set for it.
+ */
+NimBLEAttValue NimBLECharacteristic::getPeerValue(uint16_t connHandle) const {
+    return getPeerAttVal(connHandle);
+} // getPeerValue
+
+/**
+ * @brief Get the value a connection reads.
+ * @param [in] connHandle The connection handle of the peer.
+ * @return The value of the peer when per connection values are enabled and it has one, else the shared value.
+ */
+const NimBLEAttValue& NimBLECharacteristic::getPeerAttVal(uint16_t connHandle) const {
+    if (m_pPeerValues) {
+        const PeerValues::Slot* pSlot = m_pPeerValues->find(connHandle);
+        if (pSlot && pSlot->connHandle == connHandle) {
+            return pSlot->value;
+        }
+    }
+
+    return m_value;
+} // getPeerAttVal
+
+/**
+ * @brief Send the value of each target connection.
+ * @param [in] connHandle The connection to send to, or BLE_HS_CONN_HANDLE_NONE for all subscribers.
+ * @param [in] send The function that sends a value to a connection.
+ * @return True if all values were sent or queued.
+ */
+bool NimBLECharacteristic::sendPeerValues(uint16_t                                                      connHandle,
+                                          const std::function<bool(const NimBLEAttValue&, uint16_t)>& send) const {
+    if (connHandle != BLE_HS_CONN_HANDLE_NONE) {
+        return send(NimBLEAttValue{getPeerAttVal(connHandle)}, connHandle);
+    }
+
+    TargetArray targets{};
+    size_t      numTargets = getSendTargets(BLE_HS_CONN_HANDLE_NONE, targets);
+    bool        success    = true;
+    for (size_t i = 0; i < numTargets; i++) {
+        // copy to avoid issues if the value is changed while sending
+        if (!send(NimBLEAttValue{getPeerAttVal(targets[i])}, targets[i])) {
+            success = false;
+        }
+    }
+
+    return success;
+} // sendPeerValues
+
+/**
+ * @brief Release the value of a connection that has closed.
+ * @param [in] connHandle The connection handle of the peer.
+ */
+void NimBLECharacteristic::clearPeerValue(uint16_t connHandle) {
+    PeerValues::Slot* pSlot = m_pPeerValues ? m_pPeerValues->find(connHandle) : nullptr;
+    if (pSlot && pSlot->connHandle == connHandle) {
+        pSlot->connHandle = BLE_HS_CONN_HANDLE_NONE;
+        pSlot->value      = NimBLEAttValue(uint16_t{0}, m_pPeerValues->m_maxLen);
+    }
+} // clearPeerValue
+
+/**
+ * @brief Queue a notification of the current value without blocking.
+ * @param[in] connHandle Connection handle to send an individual notification, or BLE_HS_CONN_HANDLE_NONE to send
+ * the notification to all subscribed clients.
+ * @param[in] cb Optional callback invoked from the NimBLE host task once the value has been sent or dropped.
+ * @return True if the value was queued, false if the queue is full or the peer is not subscribed.
+ */
+bool NimBLECharacteristic::notifyAsync(uint16_t connHandle, NotifyCompleteCallback cb) {
+    if (m_pPeerValues) {
+        return sendPeerValues(connHandle, [this, &cb](const NimBLEAttValue& v, uint16_t conn) {
+            return notifyAsync(v.data(), v.size(), conn, cb);
+        });
+    }
+
+    auto value{m_value}; // make a copy to avoid issues if the value is changed while queuing
+    return notifyAsync(value.data(), value.size(), connHandle, std::move(cb));
+} // notifyAsync
+
+/**
+ * @brief Queue a notification without blocking.
+ * @param[in] value A pointer to the data to send.
+ * @param[in] length The length of the data to send.
+ * @param[in] connHandle Connection handle to send an individual notification, or BLE_HS_CONN_HANDLE_NONE to send
+ * the notification to all subscribed clients.
+ * @param[in] cb Optional callback invoked from the NimBLE host task once the value has been sent or dropped.
+ * @return True if the value was queued, false if the queue is full or the peer is not subscribed.
+ * @details When no client is subscribed the value is not queued and the callback is still reported from the
+ * host task with 0. The value is copied into the queue and sent from the NimBLE host task as buffers become
+ * available, the caller never waits for the stack. When the queue is full the configured
+ * NotifyQueuePolicy decides whether the new or the oldest value is dropped.
+ */
+bool NimBLECharacteristic::notifyAsync(const uint8_t* value, size_t length, uint16_t connHandle, NotifyCompleteCallback cb) {
+    if (!m_pNotifyQueue && !setNotifyQueue(MYNEWT_VAL(NIMBLE_CPP_NOTIFY_QUEUE_DEFAULT_DEPTH))) {
+        return false;
+    }
+
+    TargetArray targets{};
+    size_t      numTargets = getSendTargets(connHandle, targets);
+    if (numTargets == 0) {
+        if (connHandle != BLE_HS_CONN_HANDLE_NONE) {
+            return false;
+        }
+
+        if (!cb) {
+            return true;
+        }
+
+        if (!m_pNotifyQueue->addCompletion(cb, 0)) {
+            return false;
+        }
+    } else if (!m_pNotifyQueue->push(value, length, targets, numTargets, cb)) {
+        NIMBLE_LOGD(LOG_TAG, "Notify queue full, value dropped");
+        return false;
+    }
+
+    ble_npl_eventq_put(nimble_port_get_dflt_eventq(), &m_pNotifyQueue->m_drainEvent);
+    return true;
+} // notifyAsync
+
+/**
+ * @brief Schedule the notification queue and coalesced notifications to be sent on the host task if values are waiting.
+ */
+void NimBLECharacteristic::scheduleNotifyQueueDrain() {
+    if (m_pNotifyQueue && m_pNotifyQueue->pending()) {
+        ble_npl_eventq_put(nimble_port_get_dflt_eventq(), &m_pNotifyQueue->m_drainEvent);
+    }
+
+    if (m_pCoalescer && m_pCoalescer->pending()) {
+        ble_npl_eventq_put(nimble_port_get_dflt_eventq(), &m_pCoalescer->m_flushEvent);
+    }
+} // scheduleNotifyQueueDrain
+
+/**
+ * @brief Event callback to drain the notification queue.
+ * @param[in] ev Pointer to the event that triggered the callback.
+ */
+void NimBLECharacteristic::notifyQueueEventCb(struct ble_npl_event* ev) {
+    auto* pChr = static_cast<NimBLECharacteristic*>(ble_npl_event_get_arg(ev));
+    if (pChr) {
+        pChr->drainNotifyQueue();
+    }
+} // notifyQueueEventCb
+
+/**
+ * @brief Send queued notifications until the queue is empty or the stack runs out of buffers.
+ * @details Called only from the NimBLE host task. When out of buffers the drain is resumed by the next
+ * transmit completion of the characteristic, with a callout as a fallback in case none follows.
+ * Peers that fail for any other reason are skipped.
+ */
+void NimBLECharacteristic::drainNotifyQueue() {
+    NotifyQueue* q = m_pNotifyQueue;
+    if (!q) {
+        return;
+    }
+
+    std::vector<std::pair<NotifyCompleteCallback, int>> completions;
+    q->takeCompletions(completions);
+    for (auto& completion : completions) {
+        completion.first(this, completion.second);
+    }
+
+    while (q->m_hasInflight || q->popInflight()) {
+        auto& item = q->m_inflight;
+        while (item.nextTarget < item.numTargets) {
+            size_t numSent = 0;
+            int    rc      = sendToTargets(item.value.data(),
+                                   item.value.size(),
+                                   true,
+                                   &item.targets[item.nextTarget],
+                                   item.numTargets - item.nextTarget,
+                                   &numSent,
+                                   false);
+            item.nextTarget += numSent;
+            if (rc == 0) {
+                break;
+            }
+
+            if (rc == BLE_HS_ENOMEM) {
+                ble_npl_time_t retry = ble_npl_time_ms_to_ticks32(MYNEWT_VAL(NIMBLE_CPP_NOTIFY_RETRY_MS));
+                ble_npl_callout_reset(&q->m_retryTimer, retry > 0 ? retry : 1);
+                return;
+            }
+
+            if (item.rc == 0) {
+                item.rc = rc;
+            }
+            item.nextTarget++;
+        }
+
+        NotifyCompleteCallback cb = std::move(item.cb);
+        int                    rc = item.rc;
+        item.cb                   = nullptr;
+        q->finishInflight();
+        if (cb) {
+            cb(this, rc);
+        }
+    }
+} // drainNotifyQueue
 
 /**
  * @brief Process a subscription or unsubscription request from a peer.
@@ -433,10 +1815,26 @@ void NimBLECharacteristic::readEvent(NimBLEConnInfo& connInfo) {
  * @param [in] connInfo A reference to a NimBLEConnInfo instance containing the peer info.
  */
 void NimBLECharacteristic::writeEvent(const uint8_t* val, uint16_t len, NimBLEConnInfo& connInfo) {
-    setValue(val, len);
+    if (!m_pPeerValues || !setPeerValue(connInfo.getConnHandle(), val, len)) {
+        setValue(val, len);
+    }
+
     m_pCallbacks->onWrite(this, connInfo);
 } // writeEvent
 
+/**
+ * @brief Handle a segment of a write from a client when chunked writes are enabled.
+ * @param [in] data A pointer to the segment data, valid only for the duration of the call.
+ * @param [in] len The length of the segment.
+ * @param [in] offset The offset of the segment within the written value.
+ * @param [in] isLast True if this is the final segment of the written value.
+ * @param [in] connInfo A reference to a NimBLEConnInfo instance containing the peer info.
+ */
+void NimBLECharacteristic::writeChunkEvent(
+    const uint8_t* data, uint16_t len, uint16_t offset, bool isLast, NimBLEConnInfo& connInfo) {
+    m_pCallbacks->onWriteChunk(this, connInfo, data, len, offset, isLast);
+} // writeChunkEvent
+
 /**
  * @brief Set the callback handlers for this characteristic.
  * @param [in] pCallbacks An instance of a NimBLECharacteristicCallbacks class\n
@@ -494,6 +1892,26 @@ void NimBLECharacteristicCallbacks::onWrite(NimBLECharacteristic* pCharacteristi
     NIMBLE_LOGD("NimBLECharacteristicCallbacks", "onWrite: default");
 } // onWrite
 
+/**
+ * @brief Callback function to receive a segment of a client write when chunked writes are enabled.
+ * @param [in] pCharacteristic The characteristic that is the source of the event.
+ * @param [in] connInfo A reference to a NimBLEConnInfo instance containing the peer info.
+ * @param [in] data A pointer to the segment data, only valid for the duration of the call.
+ * @param [in] len The length of the segment.
+ * @param [in] offset The offset of the segment within the written value.
+ * @param [in] isLast True if this is the final segment of the written value.
+ * @details A write is delivered as one or more consecutive calls, a zero length write results in a single call
+ * with len 0 and isLast set. See NimBLECharacteristic::setChunkedWrite.
+ */
+void NimBLECharacteristicCallbacks::onWriteChunk(NimBLECharacteristic* pCharacteristic,
+                                                 NimBLEConnInfo&       connInfo,
+                                                 const uint8_t*        data,
+                                                 uint16_t              len,
+                                                 uint16_t              offset,
+                                                 bool                  isLast) {
+    NIMBLE_LOGD("NimBLECharacteristicCallbacks", "onWriteChunk: default");
+} // onWriteChunk
+
 /**
  * @brief Callback function to support a Notify/Indicate Status report.
  * @param [in] pCharacteristic The characteristic that is the source of the event.
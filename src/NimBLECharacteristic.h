@@ -32,6 +32,25 @@ class NimBLE2904;
 # include <string>
 # include <vector>
 # include <array>
+# include <functional>
+
+# ifndef MYNEWT_VAL_NIMBLE_CPP_NOTIFY_QUEUE_DEFAULT_DEPTH
+#  ifndef CONFIG_NIMBLE_CPP_NOTIFY_QUEUE_DEFAULT_DEPTH
+#   define MYNEWT_VAL_NIMBLE_CPP_NOTIFY_QUEUE_DEFAULT_DEPTH 8
+#  else
+#   define MYNEWT_VAL_NIMBLE_CPP_NOTIFY_QUEUE_DEFAULT_DEPTH CONFIG_NIMBLE_CPP_NOTIFY_QUEUE_DEFAULT_DEPTH
+#  endif
+# endif
+
+# ifndef MYNEWT_VAL_NIMBLE_CPP_NOTIFY_RETRY_MS
+#  ifndef CONFIG_NIMBLE_CPP_NOTIFY_RETRY_MS
+#   define MYNEWT_VAL_NIMBLE_CPP_NOTIFY_RETRY_MS (20)
+#  else
+#   define MYNEWT_VAL_NIMBLE_CPP_NOTIFY_RETRY_MS CONFIG_NIMBLE_CPP_NOTIFY_RETRY_MS
+#  endif
+# endif
+
+struct ble_npl_event;
 
 /**
  * @brief The model of a BLE Characteristic.
@@ -41,6 +60,51 @@ class NimBLE2904;
  */
 class NimBLECharacteristic : public NimBLELocalValueAttribute {
   public:
+    /** @brief Action taken by notifyAsync when the notification queue is full. */
+    enum NotifyQueuePolicy : uint8_t {
+        DROP_NEW,   // Reject the new value, notifyAsync returns false.
+        DROP_OLDEST // Discard the oldest queued value, its completion callback receives BLE_HS_EPREEMPTED.
+    };
+
+    /** @brief Action taken when a client write does not fit in the write ring. */
+    enum WriteRingPolicy : uint8_t {
+        DROP_NEW_WRITE,   // Discard the new write, a write request is answered with an insufficient resources error.
+        DROP_OLDEST_WRITE // Discard the oldest stored writes until the new write fits.
+    };
+
+    /** @brief A client write read from the write ring, data points into the buffer passed to readWrites(). */
+    struct WriteRecord {
+        const uint8_t* data;
+        uint16_t       length;
+        uint16_t       connHandle;
+    };
+
+    /** @brief Write ring counters. */
+    struct WriteRingStats {
+        uint32_t received{0};  // Writes stored in the ring.
+        uint32_t dropped{0};   // Writes discarded by the overflow policy or because they were larger than the ring.
+        uint32_t highWater{0}; // Highest number of bytes in use, including the record headers.
+    };
+
+    /**
+     * @brief Called from the NimBLE host task when a write is stored in an empty ring.
+     * @details Keep this short, for example notify the consumer task.
+     */
+    using WriteRingCallback = std::function<void(NimBLECharacteristic* pCharacteristic)>;
+
+    /**
+     * @brief Called when a queued notification has been handed to the stack for all of its peers or was dropped.
+     * @details rc is 0 on success, otherwise the first error encountered.
+     */
+    using NotifyCompleteCallback = std::function<void(NimBLECharacteristic* pCharacteristic, int rc)>;
+
+    /**
+     * @brief Called for each connection when a queued indication has been confirmed, has failed or has timed out.
+     * @details rc is 0 when the peer confirmed the indication, otherwise the error that ended it.
+     */
+    using IndicateCompleteCallback =
+        std::function<void(NimBLECharacteristic* pCharacteristic, uint16_t connHandle, int rc)>;
+
     NimBLECharacteristic(const char*    uuid,
                          uint16_t       properties = NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::WRITE,
                          uint16_t       maxLen     = BLE_ATT_ATTR_MAX_LEN,
@@ -61,6 +125,31 @@ class NimBLECharacteristic : public NimBLELocalValueAttribute {
     bool        indicate(const uint8_t* value, size_t length, uint16_t connHandle = BLE_HS_CONN_HANDLE_NONE) const;
     bool        notify(uint16_t connHandle = BLE_HS_CONN_HANDLE_NONE) const;
     bool        notify(const uint8_t* value, size_t length, uint16_t connHandle = BLE_HS_CONN_HANDLE_NONE) const;
+    bool        notifyAsync(uint16_t connHandle = BLE_HS_CONN_HANDLE_NONE, NotifyCompleteCallback cb = nullptr);
+    bool        notifyAsync(const uint8_t*         value,
+                            size_t                 length,
+                            uint16_t               connHandle = BLE_HS_CONN_HANDLE_NONE,
+                            NotifyCompleteCallback cb         = nullptr);
+    bool        indicateAsync(uint16_t connHandle = BLE_HS_CONN_HANDLE_NONE, IndicateCompleteCallback cb = nullptr);
+    bool        indicateAsync(const uint8_t*           value,
+                              size_t                   length,
+                              uint16_t                 connHandle = BLE_HS_CONN_HANDLE_NONE,
+                              IndicateCompleteCallback cb         = nullptr);
+    bool        setNotifyQueue(uint8_t depth, NotifyQueuePolicy policy = DROP_NEW);
+    size_t      getNotifyQueueCount() const;
+    bool        setNotifyCoalescing(uint32_t periodMs);
+    void        setChunkedWrite(bool enable);
+    bool        isChunkedWrite() const;
+    bool        setWriteRing(size_t size, WriteRingPolicy policy = DROP_NEW_WRITE, WriteRingCallback cb = nullptr);
+    size_t      readWrites(uint8_t* buf, size_t bufLen, WriteRecord* records, size_t maxRecords);
+    size_t      getWriteRingCount() const;
+    void        resetWriteRingStats();
+    bool        setPerConnectionValues(bool enable);
+    bool        isPerConnectionValues() const;
+    bool        setPeerValue(uint16_t connHandle, const uint8_t* value, size_t length);
+
+    NimBLEAttValue getPeerValue(uint16_t connHandle) const;
+    WriteRingStats getWriteRingStats() const;
 
     NimBLEDescriptor* createDescriptor(const char* uuid,
                                        uint32_t    properties = NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::WRITE,
@@ -266,6 +355,32 @@ class NimBLECharacteristic : public NimBLELocalValueAttribute {
     }
 # endif
 
+    /**
+     * @brief Template to encode fields with a NimBLESchema and send them as a notification to all subscribers.
+     * @tparam Schema The NimBLESchema type describing the payload layout.
+     * @param [in] values The field values, in schema order.
+     * @return True if the notification was sent successfully, false otherwise.
+     * @details To send to a single connection use <tt>notify(Schema::pack(values...), connHandle)</tt>.
+     */
+    template <typename Schema, typename... Args>
+    bool notifyFields(const Args&... values) const {
+        const typename Schema::buffer_type buf = Schema::pack(values...);
+        return notify(buf.data(), buf.size());
+    }
+
+    /**
+     * @brief Template to encode fields with a NimBLESchema and send them as an indication to all subscribers.
+     * @tparam Schema The NimBLESchema type describing the payload layout.
+     * @param [in] values The field values, in schema order.
+     * @return True if the indication was sent successfully, false otherwise.
+     * @details To send to a single connection use <tt>indicate(Schema::pack(values...), connHandle)</tt>.
+     */
+    template <typename Schema, typename... Args>
+    bool indicateFields(const Args&... values) const {
+        const typename Schema::buffer_type buf = Schema::pack(values...);
+        return indicate(buf.data(), buf.size());
+    }
+
   private:
     friend class NimBLEServer;
     friend class NimBLEService;
@@ -273,11 +388,46 @@ class NimBLECharacteristic : public NimBLELocalValueAttribute {
     void setService(NimBLEService* pService);
     void readEvent(NimBLEConnInfo& connInfo) override;
     void writeEvent(const uint8_t* val, uint16_t len, NimBLEConnInfo& connInfo) override;
+    void writeChunkEvent(const uint8_t* data, uint16_t len, uint16_t offset, bool isLast, NimBLEConnInfo& connInfo);
     bool sendValue(const uint8_t* value,
                    size_t         length,
                    bool           is_notification = true,
                    uint16_t       connHandle      = BLE_HS_CONN_HANDLE_NONE) const;
 
+    struct NotifyQueue;
+    using TargetArray = std::array<uint16_t, MYNEWT_VAL(BLE_MAX_CONNECTIONS)>;
+    size_t      getSendTargets(uint16_t connHandle, TargetArray& targets) const;
+    int         sendToTargets(const uint8_t*  value,
+                              size_t          length,
+                              bool            isNotification,
+                              const uint16_t* targets,
+                              size_t          numTargets,
+                              size_t*         numSent,
+                              bool            wait) const;
+    static int  sendToTargets(uint16_t        attrHandle,
+                              const uint8_t*  value,
+                              size_t          length,
+                              bool            isNotification,
+                              const uint16_t* targets,
+                              size_t          numTargets,
+                              size_t*         numSent,
+                              bool            wait);
+    void        scheduleNotifyQueueDrain();
+    void        drainNotifyQueue();
+    static void notifyQueueEventCb(struct ble_npl_event* ev);
+
+    struct Coalescer;
+    void        flushCoalesced();
+    static void coalesceEventCb(struct ble_npl_event* ev);
+
+    struct WriteRing;
+    int ringWriteEvent(const os_mbuf* om, uint16_t len, uint16_t connHandle);
+
+    struct PeerValues;
+    const NimBLEAttValue& getPeerAttVal(uint16_t connHandle) const override;
+    bool sendPeerValues(uint16_t connHandle, const std::function<bool(const NimBLEAttValue&, uint16_t)>& send) const;
+    void clearPeerValue(uint16_t connHandle);
+
     struct SubPeerEntry {
         enum : uint8_t { AWAITING_SECURE = 1 << 0, SECURE = 1 << 1, SUB_NOTIFY = 1 << 2, SUB_INDICATE = 1 << 3 };
         void     setConnHandle(uint16_t connHandle) { m_connHandle = connHandle; }
@@ -305,6 +455,11 @@ class NimBLECharacteristic : public NimBLELocalValueAttribute {
     NimBLEService*                 m_pService{nullptr};
     std::vector<NimBLEDescriptor*> m_vDescriptors{};
     mutable SubPeerArray           m_subPeers{};
+    NotifyQueue*                   m_pNotifyQueue{nullptr};
+    Coalescer*                     m_pCoalescer{nullptr};
+    PeerValues*                    m_pPeerValues{nullptr};
+    WriteRing*                     m_pWriteRing{nullptr};
+    bool                           m_chunkedWrite{false};
 }; // NimBLECharacteristic
 
 /**
@@ -319,6 +474,12 @@ class NimBLECharacteristicCallbacks {
     virtual ~NimBLECharacteristicCallbacks() {}
     virtual void onRead(NimBLECharacteristic* pCharacteristic, NimBLEConnInfo& connInfo);
     virtual void onWrite(NimBLECharacteristic* pCharacteristic, NimBLEConnInfo& connInfo);
+    virtual void onWriteChunk(NimBLECharacteristic* pCharacteristic,
+                              NimBLEConnInfo&       connInfo,
+                              const uint8_t*        data,
+                              uint16_t              len,
+                              uint16_t              offset,
+                              bool                  isLast);
     virtual void onStatus(NimBLECharacteristic* pCharacteristic, int code); // deprecated
     virtual void onStatus(NimBLECharacteristic* pCharacteristic, NimBLEConnInfo& connInfo, int code);
     virtual void onSubscribe(NimBLECharacteristic* pCharacteristic, NimBLEConnInfo& connInfo, uint16_t subValue);
@@ -20,6 +20,8 @@
 
 # include "NimBLERemoteService.h"
 # include "NimBLERemoteCharacteristic.h"
+# include "NimBLERemoteDescriptor.h"
+# include "NimBLEAttributeCache.h"
 # include "NimBLEDevice.h"
 # include "NimBLELog.h"
 
@@ -29,7 +31,13 @@
 #  include "nimble/nimble_port.h"
 # endif
 
+# include <algorithm>
 # include <climits>
+# include <new>
+
+# ifndef MYNEWT_VAL_BLE_GATT_READ_MAX_ATTRS
+#  define MYNEWT_VAL_BLE_GATT_READ_MAX_ATTRS (8)
+# endif
 
 static const char*           LOG_TAG = "NimBLEClient";
 static NimBLEClientCallbacks defaultCallbacks;
@@ -76,6 +84,11 @@ NimBLEClient::NimBLEClient(const NimBLEAddress& peerAddress)
       m_connStatus{DISCONNECTED},
       m_connectCallbackPending{false},
       m_connectFailRetryCount{0},
+      m_attCacheChecked{0},
+      m_attCacheInvalid{0},
+      m_attComplete{0},
+      m_dbHashValid{0},
+      m_linkProfileApplied{0},
 # if MYNEWT_VAL(BLE_EXT_ADV)
       m_phyMask{BLE_GAP_LE_PHY_1M_MASK | BLE_GAP_LE_PHY_2M_MASK | BLE_GAP_LE_PHY_CODED_MASK},
 # endif
@@ -114,12 +127,16 @@ NimBLEClient::~NimBLEClient() {
  * @brief Delete all service objects created by this client and clear the vector.
  */
 void NimBLEClient::deleteServices() {
+    std::vector<NotifyEntry>().swap(m_notifyTable);
+
     // Delete all the services.
     for (auto& it : m_svcVec) {
         delete it;
     }
 
     std::vector<NimBLERemoteService*>().swap(m_svcVec);
+    m_attComplete     = 0;
+    m_attCacheInvalid = 0;
 } // deleteServices
 
 /**
@@ -133,6 +150,7 @@ size_t NimBLEClient::deleteService(const NimBLEUUID& uuid) {
         if ((*it)->getUUID() == uuid) {
             delete *it;
             m_svcVec.erase(it);
+            m_attComplete = 0;
             break;
         }
     }
@@ -174,7 +192,17 @@ bool NimBLEClient::connect(bool deleteAttributes, bool asyncConnect, bool exchan
 } // connect
 
 int NimBLEClient::startConnectionAttempt(const ble_addr_t* peerAddr) {
-    int rc = 0;
+    int                 rc     = 0;
+    ble_gap_conn_params params = m_connParams;
+
+    // Keep the interval range of the application, the recorded interval is usually the slower one the peer
+    // asked for once connected. Reuse the latency and timeout the link ended up with if they are valid for it,
+    // the supervision timeout must exceed (1 + latency) * itvl_max * 2, i.e. timeout * 4 > (1 + latency) * itvl_max.
+    if (m_config.reuseLinkProfile && m_linkProfile.valid && m_linkProfile.supervisionTimeout != 0 &&
+        m_linkProfile.supervisionTimeout * 4UL > (m_linkProfile.connLatency + 1UL) * params.itvl_max) {
+        params.latency             = m_linkProfile.connLatency;
+        params.supervision_timeout = m_linkProfile.supervisionTimeout;
+    }
 
     do {
 # if MYNEWT_VAL(BLE_EXT_ADV)
@@ -182,9 +210,9 @@ int NimBLEClient::startConnectionAttempt(const ble_addr_t* peerAddr) {
                                  peerAddr,
                                  m_connectTimeout,
                                  m_phyMask,
-                                 &m_connParams,
-                                 &m_connParams,
-                                 &m_connParams,
+                                 &params,
+                                 &params,
+                                 &params,
                                  NimBLEClient::handleGapEvent,
                                  this);
 
@@ -192,7 +220,7 @@ int NimBLEClient::startConnectionAttempt(const ble_addr_t* peerAddr) {
         rc = ble_gap_connect(NimBLEDevice::m_ownAddrType,
                              peerAddr,
                              m_connectTimeout,
-                             &m_connParams,
+                             &params,
                              NimBLEClient::handleGapEvent,
                              this);
 # endif
@@ -270,12 +298,21 @@ bool NimBLEClient::connect(const NimBLEAddress& address, bool deleteAttributes,
         goto error;
     }
 
+    if (!asyncConnect) {
+        flushAttributeCache(); // blocking, so not on the host task
+    }
+
+    if (address != m_peerAddress) {
+        clearLinkProfile();
+    }
+
     m_connStatus             = CONNECTING;
     m_peerAddress            = address;
     m_config.asyncConnect    = asyncConnect;
     m_config.exchangeMTU     = exchangeMTU;
     m_connectCallbackPending = false;
     m_connectFailRetryCount  = 0;
+    m_connectStart           = ble_npl_time_get();
 
     rc = startConnectionAttempt(peerAddr);
 
@@ -324,6 +361,76 @@ error:
     return false;
 } // connect
 
+/**
+ * @brief Connect to a BLE Server by address without blocking the calling task.
+ * @param [in] address The address of the server.
+ * @param [in] callback The function called from the host task with this client and the result code,
+ * 0 once the connection is established, after NimBLEClientCallbacks::onConnect or onConnectFail.
+ * @param [in] deleteAttributes If true this will delete any attribute objects this client may already\n
+ * have created when last connected.
+ * @param [in] exchangeMTU If true, the client will attempt to exchange MTU with the server after connection.
+ * @return True if the connection attempt was started, the callback is only invoked in this case.
+ * @details If the client is set to delete itself on connect failure it is deleted after the callback returns.
+ */
+bool NimBLEClient::connectAsync(const NimBLEAddress& address,
+                                completion_callback  callback,
+                                bool                 deleteAttributes,
+                                bool                 exchangeMTU) {
+    if (m_connectCb != nullptr) {
+        NIMBLE_LOGE(LOG_TAG, "Already attempting to connect");
+        m_lastErr = BLE_HS_EALREADY;
+        return false;
+    }
+
+    const bool deleteOnFail = m_config.deleteOnConnectFail;
+    m_connectCb             = std::move(callback);
+    if (!connect(address, deleteAttributes, true, exchangeMTU)) {
+        // connect deletes this client on failure if set to do so, do not touch the members then.
+        if (!deleteOnFail) {
+            m_connectCb = nullptr;
+        }
+        return false;
+    }
+
+    return true;
+} // connectAsync
+
+/**
+ * @brief Invoke the pending connectAsync callback, if any.
+ * @param [in] rc The result of the connection attempt.
+ */
+void NimBLEClient::completeConnectAsync(int rc) {
+    if (m_connectCb == nullptr) {
+        return;
+    }
+
+    auto callback = std::move(m_connectCb);
+    m_connectCb   = nullptr;
+    callback(this, rc);
+} // completeConnectAsync
+
+/**
+ * @brief Take over a connection to the peer of this client that was initiated by another GAP event handler.
+ * @param [in] event The successful BLE_GAP_EVENT_CONNECT event of the connection.
+ * @param [in] exchangeMTU If true, the client will attempt to exchange MTU with the server after connection.
+ * @param [in] callback The function called from the host task once the connection is established.
+ * @return The result of handling the connect event.
+ * @details Used for connections created through the accept list, where the peer is only known once the
+ * connection is complete. The caller routes the later GAP events of the connection to handleGapEvent.
+ * Attributes of a previous connection are deleted.
+ */
+int NimBLEClient::adoptConnection(struct ble_gap_event* event, bool exchangeMTU, completion_callback callback) {
+    deleteServices();
+    m_connStatus             = CONNECTING;
+    m_config.asyncConnect    = true;
+    m_config.exchangeMTU     = exchangeMTU;
+    m_connectCallbackPending = false;
+    m_connectFailRetryCount  = 0;
+    m_connectStart           = 0;
+    m_connectCb              = std::move(callback);
+    return NimBLEClient::handleGapEvent(event, this);
+} // adoptConnection
+
 /**
  * @brief Initiate a secure connection (pair/bond) with the server.\n
  * Called automatically when a characteristic or descriptor requires encryption or authentication to access it.
@@ -434,6 +541,55 @@ void NimBLEClient::setConfig(NimBLEClient::Config config) {
     m_config = config;
 } // setConfig
 
+/**
+ * @brief Set whether to apply the link profile of the last connection when reconnecting to the same peer.
+ * @param [in] reuse If true, reconnections use the last peripheral latency and supervision timeout with the
+ * interval range set by setConnectionParams and request the last data length, PHY and encryption right
+ * after connecting, the MTU exchange is skipped if the peer did not accept a larger MTU before.
+ * @details The profile is kept per peer address and cleared when connecting to a different peer.
+ * Combined with connect(false) the attributes discovered on the last connection are also kept.
+ */
+void NimBLEClient::setLinkProfileReuse(bool reuse) {
+    m_config.reuseLinkProfile = reuse;
+} // setLinkProfileReuse
+
+/**
+ * @brief Get the link profile recorded from the connections to the peer.
+ * @return A reference to the link profile.
+ */
+const NimBLEClient::LinkProfile& NimBLEClient::getLinkProfile() const {
+    return m_linkProfile;
+} // getLinkProfile
+
+/**
+ * @brief Clear the recorded link profile, the next connection negotiates everything again.
+ */
+void NimBLEClient::clearLinkProfile() {
+    m_linkProfile = LinkProfile{};
+} // clearLinkProfile
+
+/**
+ * @brief Request the data length, PHY and encryption of the stored link profile on a new connection.
+ * @details Called from the host task when the connection is created, the requests run concurrently with
+ * the MTU exchange and their responses also complete the connection establishment early.
+ */
+void NimBLEClient::applyLinkProfile() {
+    if (m_linkProfile.txOctets > 27) { // 27 octets is the default without data length extension.
+        setDataLen(m_linkProfile.txOctets);
+    }
+
+    if ((m_linkProfile.txPhy != 0 && m_linkProfile.txPhy != BLE_GAP_LE_PHY_1M) ||
+        (m_linkProfile.rxPhy != 0 && m_linkProfile.rxPhy != BLE_GAP_LE_PHY_1M)) {
+        const uint8_t txMask = m_linkProfile.txPhy ? 1 << (m_linkProfile.txPhy - 1) : BLE_GAP_LE_PHY_1M_MASK;
+        const uint8_t rxMask = m_linkProfile.rxPhy ? 1 << (m_linkProfile.rxPhy - 1) : BLE_GAP_LE_PHY_1M_MASK;
+        updatePhy(txMask, rxMask);
+    }
+
+    if (m_linkProfile.encrypted && m_linkProfile.bonded && NimBLEDevice::isBonded(m_peerAddress)) {
+        secureConnection(true);
+    }
+} // applyLinkProfile
+
 # if MYNEWT_VAL(BLE_EXT_ADV)
 /**
  * @brief Set the PHY types to use when connecting to a server.
@@ -612,6 +768,10 @@ bool NimBLEClient::setPeerAddress(const NimBLEAddress& address) {
         return false;
     }
 
+    if (address != m_peerAddress) {
+        clearLinkProfile();
+    }
+
     m_peerAddress = address;
     return true;
 } // setPeerAddress
@@ -670,6 +830,7 @@ NimBLERemoteService* NimBLEClient::getService(const char* uuid) {
 NimBLERemoteService* NimBLEClient::getService(const NimBLEUUID& uuid) {
     NIMBLE_LOGD(LOG_TAG, ">> getService: uuid: %s", uuid.toString().c_str());
 
+    restoreAttributeCache();
     for (auto& it : m_svcVec) {
         if (it->getUUID() == uuid) {
             NIMBLE_LOGD(LOG_TAG, "<< getService: found the service with uuid: %s", uuid.toString().c_str());
@@ -728,35 +889,807 @@ const std::vector<NimBLERemoteService*>& NimBLEClient::getServices(bool refresh)
         } else {
             NIMBLE_LOGI(LOG_TAG, "Found %d services", m_svcVec.size());
         }
+    } else {
+        restoreAttributeCache();
     }
 
     return m_svcVec;
 } // getServices
 
+/**
+ * @brief State of a full attribute discovery, chained through the GATT callbacks on the host task.
+ */
+struct NimBLEClient::DiscoveryState {
+    DiscoveryState(NimBLEClient* pClient, NimBLETaskData* pTaskData) : pClient{pClient}, pTaskData{pTaskData} {}
+
+    NimBLEClient*               pClient;
+    NimBLETaskData*             pTaskData;     // Waiting task of a blocking discovery.
+    completion_callback         callback;      // Completion of an asynchronous discovery.
+    size_t                      svcIdx{0};     // Service the next characteristic or descriptor range belongs to.
+    size_t                      chrIdx{0};     // Next characteristic to check for a descriptor range.
+    NimBLERemoteCharacteristic* pChr{nullptr}; // Characteristic whose descriptors are being discovered.
+    uint16_t                    procedures{0}; // Number of GATT procedures started.
+};
+
 /**
  * @brief Retrieves the full database of attributes that the peripheral has available.
  * @return True if successful.
+ * @details The services are discovered first, then the characteristics of all services with a single
+ * procedure across the whole handle range. Descriptors are only requested for characteristics followed by
+ * a gap in the handles before the next characteristic or the end of the service. The procedures are chained
+ * from the host task so the calling task waits once for the complete database.
+
+ * If an attribute cache is set and holds the complete database of the peer it is restored
+ * without any discovery procedures, otherwise the discovered database is stored in the cache.
  */
 bool NimBLEClient::discoverAttributes() {
+    if (m_discoveryPending) {
+        NIMBLE_LOGE(LOG_TAG, "Attribute discovery already in progress");
+        m_lastErr = BLE_HS_EALREADY;
+        return false;
+    }
+
+    if (m_pAttCache != nullptr) {
+        flushAttributeCache();
+        restoreAttributeCache();
+        if (m_attComplete) {
+            return true;
+        }
+    }
+
     deleteServices();
-    if (!retrieveServices()) {
+    if (m_connStatus != CONNECTED) {
+        NIMBLE_LOGE(LOG_TAG, "Disconnected, could not discover attributes -aborting");
+        return false;
+    }
+
+    NimBLETaskData taskData(this);
+    DiscoveryState state{this, &taskData};
+    int            rc = ble_gattc_disc_all_svcs(m_connHandle, NimBLEClient::discoverySvcCB, &state);
+    if (rc != 0) {
+        NIMBLE_LOGE(LOG_TAG, "ble_gattc_disc_all_svcs: rc=%d %s", rc, NimBLEUtils::returnCodeToString(rc));
+        m_lastErr = rc;
+        return false;
+    }
+
+    state.procedures   = 1;
+    m_discoveryPending = true;
+    NimBLEUtils::taskWait(taskData, BLE_NPL_TIME_FOREVER);
+    m_discoveryPending = false;
+    rc                 = taskData.m_flags;
+    if (rc != 0) {
+        m_lastErr = rc;
+        NIMBLE_LOGE(LOG_TAG, "Could not discover attributes, rc=%d %s", rc, NimBLEUtils::returnCodeToString(rc));
+        return false;
+    }
+
+    NIMBLE_LOGD(LOG_TAG, "Discovered %u services with %u GATT procedures", m_svcVec.size(), state.procedures);
+    m_attComplete = 1;
+    saveAttributeCache();
+    return true;
+} // discoverAttributes
+
+/**
+ * @brief Retrieves the full database of attributes without blocking the calling task.
+ * @param [in] callback The function called with this client and the result code, 0 on success, when the
+ * discovery is complete. It is called from the host task unless the database is restored from the cache.
+ * @return True if the discovery was started, the callback is only invoked in this case.
+ * @details The same chained procedures as discoverAttributes() are used. If an attribute cache is set
+ * and holds the complete database of a bonded peer it is restored without reading the Database Hash
+ * and the callback is called on the calling task before this returns, otherwise the discovered database
+ * is stored in the cache.\n
+ * The call is rejected while a discovery is in progress, as the services it is filling in would be deleted.
+ */
+bool NimBLEClient::discoverAttributesAsync(completion_callback callback) {
+    if (m_discoveryPending) {
+        NIMBLE_LOGE(LOG_TAG, "Attribute discovery already in progress");
+        m_lastErr = BLE_HS_EALREADY;
         return false;
     }
 
-    for (auto svc : m_svcVec) {
-        if (!svc->retrieveCharacteristics()) {
+    if (m_pAttCache != nullptr) {
+        restoreAttributeCache(false);
+        if (m_attComplete) {
+            if (callback != nullptr) {
+                callback(this, 0);
+            }
+            return true;
+        }
+    }
+
+    deleteServices();
+    if (m_connStatus != CONNECTED) {
+        NIMBLE_LOGE(LOG_TAG, "Disconnected, could not discover attributes -aborting");
+        return false;
+    }
+
+    auto pState = new (std::nothrow) DiscoveryState(this, nullptr);
+    if (pState == nullptr) {
+        m_lastErr = BLE_HS_ENOMEM;
+        return false;
+    }
+
+    // Set before the procedure starts, its completion can run on the host task before this returns.
+    pState->callback   = std::move(callback);
+    pState->procedures = 1;
+    m_discoveryPending = true;
+    int rc             = ble_gattc_disc_all_svcs(m_connHandle, NimBLEClient::discoverySvcCB, pState);
+    if (rc != 0) {
+        NIMBLE_LOGE(LOG_TAG, "ble_gattc_disc_all_svcs: rc=%d %s", rc, NimBLEUtils::returnCodeToString(rc));
+        m_lastErr          = rc;
+        m_discoveryPending = false;
+        delete pState;
+        return false;
+    }
+
+    return true;
+} // discoverAttributesAsync
+
+/**
+ * @brief Finish a full attribute discovery.
+ * @param [in] pState The discovery state, deleted here if the discovery is asynchronous.
+ * @param [in] rc The result code of the discovery.
+ * @details A blocking discovery releases the waiting task, an asynchronous discovery completes
+ * the client state and invokes the callback.
+ */
+void NimBLEClient::completeDiscovery(DiscoveryState* pState, int rc) {
+    if (pState->pTaskData != nullptr) {
+        NimBLEUtils::taskRelease(*pState->pTaskData, rc);
+        return;
+    }
+
+    auto pClient                = pState->pClient;
+    pClient->m_discoveryPending = false;
+    if (rc == 0) {
+        NIMBLE_LOGD(LOG_TAG,
+                    "Discovered %u services with %u GATT procedures",
+                    pClient->m_svcVec.size(),
+                    pState->procedures);
+        pClient->m_attComplete = 1;
+
+        NimBLEAddress peerId;
+        if (pClient->m_pAttCache != nullptr && pClient->getPeerIdentity(peerId)) {
+            pClient->storeAttributeCache(peerId, true);
+        }
+    } else {
+        NIMBLE_LOGE(LOG_TAG, "Could not discover attributes, rc=%d %s", rc, NimBLEUtils::returnCodeToString(rc));
+        pClient->m_lastErr = rc;
+    }
+
+    if (pState->callback != nullptr) {
+        pState->callback(pClient, rc);
+    }
+
+    delete pState;
+} // completeDiscovery
+
+/**
+ * @brief Service discovery callback of discoverAttributes, starts the characteristic discovery when done.
+ */
+int NimBLEClient::discoverySvcCB(uint16_t                     connHandle,
+                                 const struct ble_gatt_error* error,
+                                 const struct ble_gatt_svc*   service,
+                                 void*                        arg) {
+    auto pState  = static_cast<DiscoveryState*>(arg);
+    auto pClient = pState->pClient;
+    int  rc      = error->status;
+
+    if (rc != BLE_HS_ENOTCONN && pClient->getConnHandle() != connHandle) {
+        return 0;
+    }
+
+    if (rc == 0) {
+        pClient->m_svcVec.push_back(new NimBLERemoteService(pClient, service));
+        return 0;
+    }
+
+    if (rc == BLE_HS_EDONE) {
+        if (pClient->m_svcVec.empty()) {
+            completeDiscovery(pState, 0);
+            return 0;
+        }
+
+        rc = ble_gattc_disc_all_chrs(connHandle,
+                                     pClient->m_svcVec.front()->getStartHandle(),
+                                     pClient->m_svcVec.back()->getEndHandle(),
+                                     NimBLEClient::discoveryChrCB,
+                                     pState);
+        if (rc == 0) {
+            pState->procedures++;
+            return 0;
+        }
+
+        NIMBLE_LOGE(LOG_TAG, "ble_gattc_disc_all_chrs: rc=%d %s", rc, NimBLEUtils::returnCodeToString(rc));
+    }
+
+    completeDiscovery(pState, rc);
+    return rc;
+} // discoverySvcCB
+
+/**
+ * @brief Characteristic discovery callback of discoverAttributes.
+ * @details Characteristics are reported in handle order across all services and are assigned to
+ * the service whose handle range contains the declaration.
+ */
+int NimBLEClient::discoveryChrCB(uint16_t                     connHandle,
+                                 const struct ble_gatt_error* error,
+                                 const struct ble_gatt_chr*   chr,
+                                 void*                        arg) {
+    auto pState  = static_cast<DiscoveryState*>(arg);
+    auto pClient = pState->pClient;
+    int  rc      = error->status;
+
+    if (rc != BLE_HS_ENOTCONN && pClient->getConnHandle() != connHandle) {
+        return 0;
+    }
+
+    if (rc == 0) {
+        const auto& svcs = pClient->m_svcVec;
+        while (pState->svcIdx < svcs.size() && chr->def_handle > svcs[pState->svcIdx]->getEndHandle()) {
+            pState->svcIdx++;
+        }
+
+        // Characteristics of secondary services are outside of the discovered service ranges.
+        if (pState->svcIdx < svcs.size() && chr->def_handle >= svcs[pState->svcIdx]->getStartHandle()) {
+            auto pSvc = svcs[pState->svcIdx];
+            pSvc->m_vChars.push_back(new NimBLERemoteCharacteristic(pSvc, chr));
+        }
+        return 0;
+    }
+
+    if (rc == BLE_HS_EDONE) {
+        pState->svcIdx = 0;
+        pState->chrIdx = 0;
+        rc             = discoverNextDescriptors(pState);
+        if (rc == 0) {
+            return 0;
+        }
+    }
+
+    completeDiscovery(pState, rc);
+    return rc;
+} // discoveryChrCB
+
+/**
+ * @brief Descriptor discovery callback of discoverAttributes, continues with the next descriptor range when done.
+ */
+int NimBLEClient::discoveryDscCB(uint16_t                     connHandle,
+                                 const struct ble_gatt_error* error,
+                                 uint16_t                     chrHandle,
+                                 const struct ble_gatt_dsc*   dsc,
+                                 void*                        arg) {
+    auto pState = static_cast<DiscoveryState*>(arg);
+    int  rc     = error->status;
+
+    if (rc != BLE_HS_ENOTCONN && pState->pClient->getConnHandle() != connHandle) {
+        return 0;
+    }
+
+    if (rc == 0) {
+        if (pState->pChr->getHandle() == chrHandle) {
+            pState->pChr->m_vDescriptors.push_back(new NimBLERemoteDescriptor(pState->pChr, dsc));
+        }
+        return 0;
+    }
+
+    if (rc == BLE_HS_EDONE) {
+        rc = discoverNextDescriptors(pState);
+        if (rc == 0) {
+            return 0;
+        }
+    }
+
+    completeDiscovery(pState, rc);
+    return rc;
+} // discoveryDscCB
+
+/**
+ * @brief Start the descriptor discovery of the next characteristic followed by a gap in the handles.
+ * @param [in] pState The discovery state.
+ * @return 0 if a procedure was started or the discovery is complete,
+ * otherwise the error code of the failed procedure.
+ * @details The descriptors of a characteristic lie between its value handle and the declaration
+ * of the next characteristic, which directly precedes its value handle, or the end of the service.
+ */
+int NimBLEClient::discoverNextDescriptors(DiscoveryState* pState) {
+    const auto& svcs = pState->pClient->m_svcVec;
+    for (; pState->svcIdx < svcs.size(); pState->svcIdx++, pState->chrIdx = 0) {
+        const auto  pSvc  = svcs[pState->svcIdx];
+        const auto& chars = pSvc->m_vChars;
+        while (pState->chrIdx < chars.size()) {
+            const auto pChr      = chars[pState->chrIdx++];
+            uint16_t   endHandle = pSvc->getEndHandle();
+            if (pState->chrIdx < chars.size()) {
+                endHandle = chars[pState->chrIdx]->getHandle() - 2;
+            }
+
+            if (endHandle <= pChr->getHandle()) {
+                continue;
+            }
+
+            pState->pChr = pChr;
+
+            int rc = ble_gattc_disc_all_dscs(pState->pClient->m_connHandle,
+                                             pChr->getHandle(),
+                                             endHandle,
+                                             NimBLEClient::discoveryDscCB,
+                                             pState);
+            if (rc != 0) {
+                NIMBLE_LOGE(LOG_TAG, "ble_gattc_disc_all_dscs: rc=%d %s", rc, NimBLEUtils::returnCodeToString(rc));
+                return rc;
+            }
+
+            pState->procedures++;
+            return 0;
+        }
+    }
+
+    completeDiscovery(pState, 0);
+    return 0;
+} // discoverNextDescriptors
+
+/*
+ * Attribute cache record
+ * ----------------------
+ * The discovered attributes are stored as a flat little endian record:
+ *
+ * u8 version, u8 flags (ATT_CACHE_F_*), [16 byte database hash if ATT_CACHE_F_HASH]
+ * u16 service count, then for each service:
+ *     u16 start handle, u16 end handle, uuid, u16 characteristic count, then for each characteristic:
+ *         u16 value handle, u8 properties, uuid, u16 descriptor count, then for each descriptor:
+ *             u16 handle, uuid
+ *
+ * A uuid is stored as a u8 length (2, 4 or 16) followed by the value.
+ * The characteristic declaration handle is not stored as it always precedes the value handle.
+ */
+namespace {
+constexpr uint8_t ATT_CACHE_VERSION    = 1;
+constexpr uint8_t ATT_CACHE_F_COMPLETE = 0x01; // Produced by a full discovery of the peer database.
+constexpr uint8_t ATT_CACHE_F_HASH     = 0x02; // The peer database hash follows the header.
+
+void attCachePut16(std::vector<uint8_t>& data, uint16_t val) {
+    data.push_back(static_cast<uint8_t>(val));
+    data.push_back(static_cast<uint8_t>(val >> 8));
+} // attCachePut16
+
+void attCachePutUuid(std::vector<uint8_t>& data, const NimBLEUUID& uuid) {
+    const ble_uuid_t* base = uuid.getBase();
+    switch (uuid.bitSize()) {
+        case BLE_UUID_TYPE_16:
+            data.push_back(2);
+            attCachePut16(data, reinterpret_cast<const ble_uuid16_t*>(base)->value);
+            break;
+        case BLE_UUID_TYPE_32: {
+            uint32_t val = reinterpret_cast<const ble_uuid32_t*>(base)->value;
+            data.push_back(4);
+            attCachePut16(data, static_cast<uint16_t>(val));
+            attCachePut16(data, static_cast<uint16_t>(val >> 16));
+            break;
+        }
+        default:
+            data.push_back(16);
+            data.insert(data.end(), uuid.getValue(), uuid.getValue() + 16);
+            break;
+    }
+} // attCachePutUuid
+
+/**
+ * @brief Bounds checked reader for an attribute cache record.
+ */
+struct AttCacheReader {
+    const uint8_t* pos;
+    const uint8_t* end;
+    bool           ok{true};
+
+    const uint8_t* take(size_t len) {
+        if (!ok || static_cast<size_t>(end - pos) < len) {
+            ok = false;
+            return nullptr;
+        }
+
+        const uint8_t* ret  = pos;
+        pos                += len;
+        return ret;
+    }
+
+    uint8_t get8() {
+        const uint8_t* p = take(1);
+        return p ? p[0] : 0;
+    }
+
+    uint16_t get16() {
+        const uint8_t* p = take(2);
+        return p ? static_cast<uint16_t>(p[0] | (p[1] << 8)) : 0;
+    }
+
+    void getUuid(ble_uuid_any_t& uuid) {
+        uint8_t        len = get8();
+        const uint8_t* p   = take(len);
+        if (p == nullptr || ble_uuid_init_from_buf(&uuid, p, len) != 0) {
+            ok = false;
+        }
+    }
+}; // AttCacheReader
+
+/** @brief FNV-1a signature of a record, used to skip writing an unchanged record. */
+uint32_t attCacheSignature(const std::vector<uint8_t>& data) {
+    uint32_t sig = 2166136261U;
+    for (uint8_t b : data) {
+        sig = (sig ^ b) * 16777619U;
+    }
+    return sig;
+} // attCacheSignature
+} // namespace
+
+/**
+ * @brief Set the persistent store used to cache the attribute database of peers.
+ * @param [in] pStore A pointer to the store, or nullptr to disable caching, the store is not owned by the client.
+ * @details When set, the attributes restored or discovered on a connection are recorded in the store keyed by the
+ * identity address of the peer and restored on the next connection instead of being discovered again.
+
+ * The record is written after discoverAttributes() succeeds and, if the discovered attributes changed,
+ * when the peer disconnects. Records are only kept for bonded peers or peers exposing the Database Hash
+ * characteristic, which is then compared before a record is used. A Service Changed indication from the peer
+ * deletes the record, subscribe to the Service Changed characteristic to receive it.
+ *
+ * The store is not written from the NimBLE host task, where a flash write would stall the stack. Records
+ * produced there, by discoverAttributesAsync() and on disconnect, are kept in memory and written by the next blocking
+ * connect(), discoverAttributes() or saveAttributeCache() call from an application task. Call
+ * saveAttributeCache() from an application task after a disconnect to write the record right away.
+ * The store may be read from the host task when discoverAttributesAsync() restores a record.
+ */
+void NimBLEClient::setAttributeCache(NimBLEAttributeCacheStore* pStore) {
+    m_pAttCache = pStore;
+} // setAttributeCache
+
+/**
+ * @brief Write the attributes currently known for the connected peer to the attribute cache.
+ * @return True if the record was written or is unchanged.
+ * @details Any record kept in memory since the last disconnect or asynchronous discovery is written first.
+ * If the peer database hash has not been read yet it is read first. Must not be called from the host task.
+ */
+bool NimBLEClient::saveAttributeCache() {
+    bool hadPending = false;
+    if (!flushAttributeCache(&hadPending)) {
+        return false;
+    }
+
+    NimBLEAddress peerId;
+    if (m_pAttCache == nullptr || !getPeerIdentity(peerId)) {
+        return hadPending;
+    }
+
+    if (!m_dbHashValid) {
+        m_dbHashValid = readDatabaseHash(m_dbHash);
+    }
+
+    return storeAttributeCache(peerId);
+} // saveAttributeCache
+
+/**
+ * @brief Delete the attribute cache record of the connected peer.
+ * @return True if the record was deleted or did not exist.
+ * @details The attributes currently known are kept, the record is written again on the next full discovery.
+ */
+bool NimBLEClient::clearAttributeCache() {
+    NimBLEAddress peerId;
+    if (m_pAttCache == nullptr || !getPeerIdentity(peerId)) {
+        return false;
+    }
+
+    m_attCacheInvalid = 1;
+    m_attCacheSig     = 0;
+    return m_pAttCache->erase(peerId);
+} // clearAttributeCache
+
+/**
+ * @brief Get the identity address of the connected peer.
+ * @param [out] peerId The identity address.
+ * @return True if connected and the address was found.
+ */
+bool NimBLEClient::getPeerIdentity(NimBLEAddress& peerId) const {
+    ble_gap_conn_desc desc;
+    if (m_connHandle == BLE_HS_CONN_HANDLE_NONE || ble_gap_conn_find(m_connHandle, &desc) != 0) {
+        return false;
+    }
+
+    peerId = NimBLEAddress(desc.peer_id_addr);
+    return true;
+} // getPeerIdentity
+
+/**
+ * @brief Restore the attributes of the connected peer from the attribute cache.
+ * @param [in] readHash If false the peer Database Hash is not read, which blocks, and the record is
+ * only trusted if the peer is bonded.
+ * @return True if attributes were restored.
+ * @details This is only attempted once per connection and only when no attributes are known.
+ */
+bool NimBLEClient::restoreAttributeCache(bool readHash) {
+    if (m_pAttCache == nullptr || m_attCacheChecked || !m_svcVec.empty() || m_connStatus != CONNECTED) {
+        return false;
+    }
+
+    m_attCacheChecked = 1;
+    NimBLEAddress        peerId;
+    std::vector<uint8_t> data;
+    if (!getPeerIdentity(peerId) || !m_pAttCache->load(peerId, data)) {
+        return false;
+    }
+
+    if (data.size() < 2 || data[0] != ATT_CACHE_VERSION) {
+        NIMBLE_LOGW(LOG_TAG, "Discarding attribute cache record with unknown format");
+        m_pAttCache->erase(peerId);
+        return false;
+    }
+
+    if (data[1] & ATT_CACHE_F_HASH) {
+        std::array<uint8_t, 16> hash;
+        if (data.size() < 2 + hash.size()) {
             return false;
         }
 
-        for (auto chr : svc->m_vChars) {
-            if (!chr->retrieveDescriptors()) {
+        if (readHash && readDatabaseHash(hash)) {
+            if (memcmp(hash.data(), &data[2], hash.size()) != 0) {
+                NIMBLE_LOGI(LOG_TAG, "Peer database hash changed, discarding attribute cache record");
+                m_pAttCache->erase(peerId);
                 return false;
             }
+
+            m_dbHash      = hash;
+            m_dbHashValid = 1;
+        } else if (!NimBLEDevice::isBonded(peerId)) {
+            return false;
         }
+    } else if (!NimBLEDevice::isBonded(peerId)) {
+        return false;
+    }
+
+    if (!deserializeAttributes(data)) {
+        NIMBLE_LOGE(LOG_TAG, "Invalid attribute cache record");
+        m_pAttCache->erase(peerId);
+        return false;
     }
 
+    m_attCacheSig = attCacheSignature(data);
+    m_attComplete = (data[1] & ATT_CACHE_F_COMPLETE) ? 1 : 0;
+    NIMBLE_LOGI(LOG_TAG, "Restored %d services from the attribute cache", m_svcVec.size());
     return true;
-} // discoverAttributes
+} // restoreAttributeCache
+
+/**
+ * @brief Write the attributes currently known to the attribute cache.
+ * @param [in] peerId The identity address of the peer the attributes belong to.
+ * @param [in] defer If true, keep the record in memory for flushAttributeCache() instead of writing the store,
+ * used on the host task.
+ * @return True if the record was written, kept or is unchanged.
+ */
+bool NimBLEClient::storeAttributeCache(const NimBLEAddress& peerId, bool defer) {
+    if (m_pAttCache == nullptr || m_attCacheInvalid || m_svcVec.empty()) {
+        return false;
+    }
+
+    if (!m_dbHashValid && !NimBLEDevice::isBonded(peerId)) {
+        NIMBLE_LOGD(LOG_TAG, "Peer not bonded and has no database hash, not caching attributes");
+        return false;
+    }
+
+    std::vector<uint8_t> data;
+    serializeAttributes(data);
+    uint32_t sig = attCacheSignature(data);
+    if (sig == m_attCacheSig) {
+        return true;
+    }
+
+    if (defer) {
+        // Swap under a critical section, the record is taken by flushAttributeCache() on an application task.
+        ble_npl_hw_enter_critical();
+        std::swap(m_attCachePending, data);
+        m_attCachePendingPeer = peerId;
+        ble_npl_hw_exit_critical(0);
+        m_attCacheSig = sig;
+        return true;
+    }
+
+    if (!m_pAttCache->store(peerId, data)) {
+        return false;
+    }
+
+    m_attCacheSig = sig;
+    return true;
+} // storeAttributeCache
+
+/**
+ * @brief Write the record kept in memory by a deferred storeAttributeCache() to the attribute cache.
+ * @param [out] pHadPending If not nullptr, set to true if a record was waiting.
+ * @return True if the record was written or none was waiting.
+ * @details Called from application tasks only.
+ */
+bool NimBLEClient::flushAttributeCache(bool* pHadPending) {
+    std::vector<uint8_t> data;
+    NimBLEAddress        peerId;
+    ble_npl_hw_enter_critical();
+    std::swap(m_attCachePending, data);
+    peerId = m_attCachePendingPeer;
+    ble_npl_hw_exit_critical(0);
+
+    if (pHadPending != nullptr) {
+        *pHadPending = !data.empty();
+    }
+
+    if (data.empty() || m_pAttCache == nullptr) {
+        return true;
+    }
+
+    if (!m_pAttCache->store(peerId, data)) {
+        m_attCacheSig = 0; // the record was not written, do not skip it next time
+        return false;
+    }
+
+    return true;
+} // flushAttributeCache
+
+/**
+ * @brief Delete the attribute cache record of the connected peer after its database changed.
+ * @details The attributes currently known are kept until the application discovers them again.
+ */
+void NimBLEClient::invalidateAttributeCache() {
+    NIMBLE_LOGI(LOG_TAG, "Service Changed received, invalidating attribute cache");
+    m_attComplete = 0;
+    m_dbHashValid = 0;
+    clearAttributeCache();
+} // invalidateAttributeCache
+
+/**
+ * @brief Serialize the attributes currently known into an attribute cache record.
+ * @param [out] data The buffer to receive the record.
+ */
+void NimBLEClient::serializeAttributes(std::vector<uint8_t>& data) const {
+    data.clear();
+    data.push_back(ATT_CACHE_VERSION);
+    data.push_back((m_attComplete ? ATT_CACHE_F_COMPLETE : 0) | (m_dbHashValid ? ATT_CACHE_F_HASH : 0));
+    if (m_dbHashValid) {
+        data.insert(data.end(), m_dbHash.begin(), m_dbHash.end());
+    }
+
+    attCachePut16(data, static_cast<uint16_t>(m_svcVec.size()));
+    for (const auto svc : m_svcVec) {
+        attCachePut16(data, svc->getStartHandle());
+        attCachePut16(data, svc->getEndHandle());
+        attCachePutUuid(data, svc->getUUID());
+        attCachePut16(data, static_cast<uint16_t>(svc->m_vChars.size()));
+        for (const auto chr : svc->m_vChars) {
+            attCachePut16(data, chr->getHandle());
+            data.push_back(chr->m_properties);
+            attCachePutUuid(data, chr->getUUID());
+            attCachePut16(data, static_cast<uint16_t>(chr->m_vDescriptors.size()));
+            for (const auto dsc : chr->m_vDescriptors) {
+                attCachePut16(data, dsc->getHandle());
+                attCachePutUuid(data, dsc->getUUID());
+            }
+        }
+    }
+} // serializeAttributes
+
+/**
+ * @brief Create the remote attribute objects from an attribute cache record.
+ * @param [in] data The record.
+ * @return True if the record is valid, otherwise no attributes are created.
+ */
+bool NimBLEClient::deserializeAttributes(const std::vector<uint8_t>& data) {
+    AttCacheReader reader{data.data(), data.data() + data.size()};
+    reader.take(2);
+    if (data[1] & ATT_CACHE_F_HASH) {
+        reader.take(m_dbHash.size());
+    }
+
+    uint16_t svcCount = reader.get16();
+    for (uint16_t i = 0; i < svcCount && reader.ok; i++) {
+        ble_gatt_svc svcDef{};
+        svcDef.start_handle = reader.get16();
+        svcDef.end_handle   = reader.get16();
+        reader.getUuid(svcDef.uuid);
+        if (!reader.ok) {
+            break;
+        }
+
+        auto pSvc = new NimBLERemoteService(this, &svcDef);
+        m_svcVec.push_back(pSvc);
+
+        uint16_t chrCount = reader.get16();
+        for (uint16_t j = 0; j < chrCount && reader.ok; j++) {
+            ble_gatt_chr chrDef{};
+            chrDef.val_handle = reader.get16();
+            chrDef.def_handle = chrDef.val_handle - 1;
+            chrDef.properties = reader.get8();
+            reader.getUuid(chrDef.uuid);
+            if (!reader.ok) {
+                break;
+            }
+
+            auto pChr = new NimBLERemoteCharacteristic(pSvc, &chrDef);
+            pSvc->m_vChars.push_back(pChr);
+
+            uint16_t dscCount = reader.get16();
+            for (uint16_t k = 0; k < dscCount && reader.ok; k++) {
+                ble_gatt_dsc dscDef{};
+                dscDef.handle = reader.get16();
+                reader.getUuid(dscDef.uuid);
+                if (reader.ok) {
+                    pChr->m_vDescriptors.push_back(new NimBLERemoteDescriptor(pChr, &dscDef));
+                }
+            }
+        }
+    }
+
+    if (!reader.ok) {
+        deleteServices();
+        return false;
+    }
+
+    return true;
+} // deserializeAttributes
+
+/**
+ * @brief Read the Database Hash characteristic of the peer.
+ * @param [out] hash The database hash.
+ * @return True if the peer exposes the characteristic and it was read.
+ */
+bool NimBLEClient::readDatabaseHash(std::array<uint8_t, 16>& hash) {
+    if (m_connStatus != CONNECTED) {
+        return false;
+    }
+
+    std::array<uint8_t, 17> buf{}; // The hash followed by a flag set when it was received.
+    NimBLETaskData          taskData(this, 0, buf.data());
+    const ble_uuid16_t      uuid = BLE_UUID16_INIT(0x2B2A);
+
+    int rc = ble_gattc_read_by_uuid(m_connHandle, 1, 0xFFFF, &uuid.u, NimBLEClient::databaseHashReadCB, &taskData);
+    if (rc != 0) {
+        NIMBLE_LOGE(LOG_TAG, "ble_gattc_read_by_uuid: rc=%d %s", rc, NimBLEUtils::returnCodeToString(rc));
+        return false;
+    }
+
+    NimBLEUtils::taskWait(taskData, BLE_NPL_TIME_FOREVER);
+    rc = taskData.m_flags;
+    if ((rc != 0 && rc != BLE_HS_EDONE) || !buf[16]) {
+        NIMBLE_LOGD(LOG_TAG, "Database hash not read, rc=%d %s", rc, NimBLEUtils::returnCodeToString(rc));
+        return false;
+    }
+
+    memcpy(hash.data(), buf.data(), hash.size());
+    return true;
+} // readDatabaseHash
+
+/**
+ * @brief Callback for the Database Hash characteristic read.
+ */
+int NimBLEClient::databaseHashReadCB(uint16_t                     connHandle,
+                                     const struct ble_gatt_error* error,
+                                     struct ble_gatt_attr*        attr,
+                                     void*                        arg) {
+    auto pTaskData = static_cast<NimBLETaskData*>(arg);
+    auto pClient   = static_cast<NimBLEClient*>(pTaskData->m_pInstance);
+
+    if (error->status == BLE_HS_ENOTCONN) {
+        NimBLEUtils::taskRelease(*pTaskData, error->status);
+        return error->status;
+    }
+
+    if (pClient->getConnHandle() != connHandle) {
+        return 0;
+    }
+
+    if (error->status == 0 && attr != nullptr) {
+        auto buf = static_cast<uint8_t*>(pTaskData->m_pBuf);
+        if (OS_MBUF_PKTLEN(attr->om) == 16 && os_mbuf_copydata(attr->om, 0, 16, buf) == 0) {
+            buf[16] = 1;
+        }
+        return 0;
+    }
+
+    NimBLEUtils::taskRelease(*pTaskData, error->status);
+    return error->status;
+} // databaseHashReadCB
 
 /**
  * @brief Ask the remote BLE server for its services.
@@ -889,6 +1822,274 @@ bool NimBLEClient::setValue(const NimBLEUUID&     serviceUUID,
     return ret;
 } // setValue
 
+/**
+ * @brief Read the values of several characteristics with ATT Read Multiple Variable Length requests.
+ * @param [in] chars The characteristics to read, they must belong to this client.
+ * @param [out] pValues Optional pointer to a vector to receive the values, in the order of chars.
+ * @return True if all values were read.
+ * @details Each characteristic value is updated as if read with readValue(). The characteristics are read
+ * in batches of up to MYNEWT_VAL(BLE_GATT_READ_MAX_ATTRS) handles, one round trip per batch.
+ * Values that do not fit in the response are truncated, use readValue() for long values.\n
+ * If the request is not supported by the stack or the peer the values are read one at a time.
+ */
+bool NimBLEClient::readValues(const std::vector<NimBLERemoteCharacteristic*>& chars,
+                              std::vector<NimBLEAttValue>*                    pValues) {
+    return readMultiple(chars, nullptr, pValues);
+} // readValues
+
+/**
+ * @brief Read the values of several fixed length characteristics with ATT Read Multiple requests.
+ * @param [in] chars The characteristics to read, they must belong to this client.
+ * @param [in] lengths The length of each characteristic value, in the order of chars.
+ * @param [out] pValues Optional pointer to a vector to receive the values, in the order of chars.
+ * @return True if all values were read.
+ * @details Each characteristic value is updated as if read with readValue(). The characteristics are read in
+ * batches that fit in a single response, one round trip per batch.\n
+ * If the request is not supported by the peer the values are read one at a time.
+ */
+bool NimBLEClient::readValues(const std::vector<NimBLERemoteCharacteristic*>& chars,
+                              const std::vector<uint16_t>&                    lengths,
+                              std::vector<NimBLEAttValue>*                    pValues) {
+    if (lengths.size() != chars.size()) {
+        NIMBLE_LOGE(LOG_TAG, "readValues: %u lengths for %u characteristics", lengths.size(), chars.size());
+        return false;
+    }
+
+    return readMultiple(chars, &lengths, pValues);
+} // readValues
+
+/**
+ * @brief Read the values of several characteristics in batches.
+ * @param [in] chars The characteristics to read.
+ * @param [in] pLengths The fixed value lengths to use Read Multiple, or nullptr to use Read Multiple Variable Length.
+ * @param [out] pValues Optional pointer to a vector to receive the values.
+ * @return True if all values were read.
+ */
+bool NimBLEClient::readMultiple(const std::vector<NimBLERemoteCharacteristic*>& chars,
+                                const std::vector<uint16_t>*                    pLengths,
+                                std::vector<NimBLEAttValue>*                    pValues) {
+    if (pValues != nullptr) {
+        pValues->clear();
+    }
+
+    if (m_connStatus != CONNECTED) {
+        NIMBLE_LOGE(LOG_TAG, "Disconnected, could not read values -aborting");
+        return false;
+    }
+
+    const bool variable = pLengths == nullptr;
+# if MYNEWT_VAL(BLE_GATT_READ_MULT_VAR)
+    bool supported = true;
+# else
+    bool supported = !variable;
+# endif
+    const size_t maxPayload = getMTU() - 1;
+    int          retryCount = 1;
+    size_t       idx        = 0;
+
+    while (idx < chars.size()) {
+        uint16_t handles[MYNEWT_VAL(BLE_GATT_READ_MAX_ATTRS)];
+        uint8_t  count = 0;
+        size_t   total = 0;
+        while (supported && idx + count < chars.size() && count < MYNEWT_VAL(BLE_GATT_READ_MAX_ATTRS)) {
+            if (!variable) {
+                total += (*pLengths)[idx + count];
+                if (count > 0 && total > maxPayload) {
+                    break;
+                }
+            }
+
+            handles[count] = chars[idx + count]->getHandle();
+            count++;
+        }
+
+        // Read Multiple requires at least two handles, read a lone value on its own.
+        if (count < 2) {
+            NimBLEAttValue value{};
+            int            rc = chars[idx]->performRead(value);
+            if (rc != 0) {
+                m_lastErr = rc;
+                NIMBLE_LOGE(LOG_TAG, "<< readValues failed rc=%d, %s", rc, NimBLEUtils::returnCodeToString(rc));
+                return false;
+            }
+
+            if (pValues != nullptr) {
+                pValues->push_back(value);
+            }
+            idx++;
+            continue;
+        }
+
+        std::vector<NimBLEAttValue> values;
+        int                         rc = readMultipleBatch(handles, count, variable, values);
+        switch (rc) {
+            case 0:
+                break;
+            case BLE_HS_ATT_ERR(BLE_ATT_ERR_REQ_NOT_SUPPORTED):
+                NIMBLE_LOGI(LOG_TAG, "Read Multiple not supported by peer, reading values individually");
+                supported = false;
+                continue;
+            case BLE_HS_ATT_ERR(BLE_ATT_ERR_INSUFFICIENT_AUTHEN):
+            case BLE_HS_ATT_ERR(BLE_ATT_ERR_INSUFFICIENT_AUTHOR):
+            case BLE_HS_ATT_ERR(BLE_ATT_ERR_INSUFFICIENT_ENC):
+                if (retryCount-- && secureConnection()) {
+                    continue;
+                }
+            /* Else falls through. */
+            default:
+                m_lastErr = rc;
+                NIMBLE_LOGE(LOG_TAG, "<< readValues failed rc=%d, %s", rc, NimBLEUtils::returnCodeToString(rc));
+                return false;
+        }
+
+        if (!variable) {
+            // The values are concatenated, split them by the given lengths.
+            std::vector<NimBLEAttValue> split;
+            size_t                      offset = 0;
+            for (uint8_t i = 0; i < count; i++) {
+                uint16_t len = (*pLengths)[idx + i];
+                if (values.empty() || offset + len > values[0].size()) {
+                    break;
+                }
+
+                split.emplace_back(values[0].data() + offset, len);
+                offset += len;
+            }
+            values.swap(split);
+        }
+
+        if (values.size() != count) {
+            m_lastErr = BLE_HS_ATT_ERR(BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN);
+            NIMBLE_LOGE(LOG_TAG, "<< readValues: got %u of %u values", values.size(), count);
+            return false;
+        }
+
+        for (uint8_t i = 0; i < count; i++) {
+            values[i].setTimeStamp();
+            chars[idx + i]->m_value = values[i];
+            if (pValues != nullptr) {
+                pValues->push_back(values[i]);
+            }
+        }
+
+        idx += count;
+    }
+
+    return true;
+} // readMultiple
+
+/**
+ * @brief Copy a received value from an mbuf chain.
+ * @return False if the value exceeds the maximum attribute length.
+ */
+static bool attValueFromMbuf(NimBLEAttValue& value, const os_mbuf* om) {
+    if (!value.setValue(om->om_data, om->om_len)) {
+        return false;
+    }
+
+    for (const os_mbuf* next = SLIST_NEXT(om, om_next); next != nullptr; next = SLIST_NEXT(next, om_next)) {
+        size_t len = value.length();
+        value.append(next->om_data, next->om_len);
+        if (value.length() != len + next->om_len) {
+            return false;
+        }
+    }
+
+    return true;
+} // attValueFromMbuf
+
+/**
+ * @brief Send a single Read Multiple or Read Multiple Variable Length request and wait for the response.
+ * @param [in] handles The attribute handles to read.
+ * @param [in] count The number of handles.
+ * @param [in] variable True to use Read Multiple Variable Length.
+ * @param [out] values The values read, for Read Multiple a single concatenated value.
+ * @return 0 on success or the error code.
+ */
+int NimBLEClient::readMultipleBatch(const uint16_t*              handles,
+                                    uint8_t                      count,
+                                    bool                         variable,
+                                    std::vector<NimBLEAttValue>& values) {
+    NimBLETaskData taskData(this, 0, &values);
+    int            rc = 0;
+
+# if MYNEWT_VAL(BLE_GATT_READ_MULT_VAR)
+    if (variable) {
+        rc = ble_gattc_read_mult_var(m_connHandle, handles, count, NimBLEClient::readMultVarCB, &taskData);
+    } else
+# endif
+    {
+        rc = ble_gattc_read_mult(m_connHandle, handles, count, NimBLEClient::readMultCB, &taskData);
+    }
+
+    if (rc != 0) {
+        return rc;
+    }
+
+    NimBLEUtils::taskWait(taskData, BLE_NPL_TIME_FOREVER);
+    rc = taskData.m_flags;
+    return rc == BLE_HS_EDONE ? 0 : rc;
+} // readMultipleBatch
+
+/**
+ * @brief Callback for the Read Multiple request, receives the concatenated values.
+ */
+int NimBLEClient::readMultCB(uint16_t                     connHandle,
+                             const struct ble_gatt_error* error,
+                             struct ble_gatt_attr*        attr,
+                             void*                        arg) {
+    auto pTaskData = static_cast<NimBLETaskData*>(arg);
+    auto pClient   = static_cast<NimBLEClient*>(pTaskData->m_pInstance);
+    int  rc        = error->status;
+
+    if (rc != BLE_HS_ENOTCONN && pClient->getConnHandle() != connHandle) {
+        return 0;
+    }
+
+    if (rc == 0 && attr != nullptr) {
+        auto pValues = static_cast<std::vector<NimBLEAttValue>*>(pTaskData->m_pBuf);
+        pValues->emplace_back();
+        if (!attValueFromMbuf(pValues->back(), attr->om)) {
+            rc = BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
+        }
+    }
+
+    NimBLEUtils::taskRelease(*pTaskData, rc);
+    return rc;
+} // readMultCB
+
+# if MYNEWT_VAL(BLE_GATT_READ_MULT_VAR)
+/**
+ * @brief Callback for the Read Multiple Variable Length request, receives each value separately.
+ */
+int NimBLEClient::readMultVarCB(uint16_t                     connHandle,
+                                const struct ble_gatt_error* error,
+                                struct ble_gatt_attr*        attrs,
+                                uint8_t                      numAttrs,
+                                void*                        arg) {
+    auto pTaskData = static_cast<NimBLETaskData*>(arg);
+    auto pClient   = static_cast<NimBLEClient*>(pTaskData->m_pInstance);
+    int  rc        = error->status;
+
+    if (rc != BLE_HS_ENOTCONN && pClient->getConnHandle() != connHandle) {
+        return 0;
+    }
+
+    if (rc == 0 && attrs != nullptr) {
+        auto pValues = static_cast<std::vector<NimBLEAttValue>*>(pTaskData->m_pBuf);
+        for (uint8_t i = 0; i < numAttrs && rc == 0; i++) {
+            pValues->emplace_back();
+            if (!attValueFromMbuf(pValues->back(), attrs[i].om)) {
+                rc = BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
+            }
+        }
+    }
+
+    NimBLEUtils::taskRelease(*pTaskData, rc);
+    return rc;
+} // readMultVarCB
+# endif
+
 /**
  * @brief Get the remote characteristic with the specified handle.
  * @param [in] handle The handle of the desired characteristic.
@@ -908,6 +2109,48 @@ NimBLERemoteCharacteristic* NimBLEClient::getCharacteristic(uint16_t handle) {
     return nullptr;
 } // getCharacteristic
 
+/**
+ * @brief Find the characteristic a notification or indication is routed to.
+ * @param [in] handle The value handle of the notification.
+ * @param [out] pServiceChanged Set to true if the characteristic is the Service Changed characteristic.
+ * @return A pointer to the characteristic or nullptr if the handle is not known.
+ * @details Characteristics are added to a table sorted by handle the first time they are notified,
+ * later notifications are routed with a binary search instead of scanning all services.
+ */
+NimBLERemoteCharacteristic* NimBLEClient::getNotifyTarget(uint16_t handle, bool* pServiceChanged) {
+    auto it = std::lower_bound(m_notifyTable.begin(),
+                               m_notifyTable.end(),
+                               handle,
+                               [](const NotifyEntry& entry, uint16_t h) { return entry.handle < h; });
+    if (it == m_notifyTable.end() || it->handle != handle) {
+        NimBLERemoteCharacteristic* pChr = getCharacteristic(handle);
+        if (pChr == nullptr) {
+            return nullptr;
+        }
+
+        const bool serviceChanged = pChr->getUUID() == NimBLEUUID(static_cast<uint16_t>(0x2A05)) &&
+                                    pChr->getRemoteService()->getUUID() == NimBLEUUID(static_cast<uint16_t>(0x1801));
+        it = m_notifyTable.insert(it, NotifyEntry{handle, serviceChanged, pChr});
+    }
+
+    *pServiceChanged = it->serviceChanged;
+    return it->pChr;
+} // getNotifyTarget
+
+/**
+ * @brief Remove a characteristic from the notification routing table.
+ * @param [in] handle The value handle of the characteristic.
+ */
+void NimBLEClient::removeNotifyTarget(uint16_t handle) {
+    auto it = std::lower_bound(m_notifyTable.begin(),
+                               m_notifyTable.end(),
+                               handle,
+                               [](const NotifyEntry& entry, uint16_t h) { return entry.handle < h; });
+    if (it != m_notifyTable.end() && it->handle == handle) {
+        m_notifyTable.erase(it);
+    }
+} // removeNotifyTarget
+
 /**
  * @brief Get the current mtu of this connection.
  * @returns The MTU value.
@@ -975,9 +2218,23 @@ bool NimBLEClient::completeConnectEstablished() {
 
     m_connectCallbackPending = false;
     ble_npl_callout_stop(&m_connectEstablishedTimer);
+    if (m_connectStart != 0) {
+        m_linkProfile.connectTimeMs = ble_npl_time_ticks_to_ms32(ble_npl_time_get() - m_connectStart);
+        if (!m_linkProfileApplied) {
+            m_linkProfile.baselineTimeMs = m_linkProfile.connectTimeMs;
+        }
+
+        NIMBLE_LOGD(LOG_TAG,
+                    "Connection established in %" PRIu32 " ms%s",
+                    m_linkProfile.connectTimeMs,
+                    m_linkProfileApplied ? " with link profile" : "");
+        m_connectStart = 0;
+    }
+
     auto pTaskData = m_pTaskData; // save a copy in case something in the callback changes it
     m_pTaskData    = nullptr;     // clear before callback to prevent other handlers from releasing
     m_pClientCallbacks->onConnect(this);
+    completeConnectAsync(0);
 
     if (pTaskData != nullptr) {
         NimBLEUtils::taskRelease(*pTaskData, 0);
@@ -1081,11 +2338,13 @@ int NimBLEClient::handleGapEvent(struct ble_gap_event* event, void* arg) {
             if (rc == connEstablishFailReason) {
                 pClient->m_pClientCallbacks->onConnectFail(pClient, rc);
             } else {
+                pClient->storeAttributeCache(NimBLEAddress(event->disconnect.conn.peer_id_addr), true);
                 pClient->m_pClientCallbacks->onDisconnect(pClient, rc);
             }
 
             pClient->m_connHandle = BLE_HS_CONN_HANDLE_NONE;
             pClient->m_connStatus = DISCONNECTED;
+            pClient->completeConnectAsync(rc);
 
             if (pClient->m_config.deleteOnDisconnect ||
                 (rc == connEstablishFailReason && pClient->m_config.deleteOnConnectFail)) {
@@ -1117,15 +2376,39 @@ int NimBLEClient::handleGapEvent(struct ble_gap_event* event, void* arg) {
                 pClient->m_connStatus             = CONNECTED;
                 pClient->m_connHandle             = event->connect.conn_handle;
                 pClient->m_connectCallbackPending = true;
+                pClient->m_attCacheChecked        = 0;
+                pClient->m_dbHashValid            = 0;
+
+                // Apply the profile of the last connection, then record this one from the events that follow.
+                LinkProfile& profile          = pClient->m_linkProfile;
+                bool         skipMTU          = false;
+                pClient->m_linkProfileApplied = pClient->m_config.reuseLinkProfile && profile.valid;
+                if (pClient->m_linkProfileApplied) {
+                    skipMTU = profile.mtu == BLE_ATT_MTU_DFLT; // the peer did not accept a larger MTU last time.
+                    pClient->applyLinkProfile();
+                }
+
+                profile.valid     = true;
+                profile.txOctets  = 0;
+                profile.txPhy     = 0;
+                profile.rxPhy     = 0;
+                profile.encrypted = false;
+                profile.bonded    = false;
+                if (!skipMTU) {
+                    profile.mtu = 0;
+                }
 
                 ble_gap_conn_desc desc;
                 if (ble_gap_conn_find(event->connect.conn_handle, &desc) == 0) {
+                    profile.connInterval       = desc.conn_itvl;
+                    profile.connLatency        = desc.conn_latency;
+                    profile.supervisionTimeout = desc.supervision_timeout;
                     pClient->startConnectEstablishedTimer(desc.conn_itvl);
                 } else {
                     pClient->startConnectEstablishedTimer(pClient->m_connParams.itvl_max);
                 }
 
-                if (pClient->m_config.exchangeMTU) {
+                if (pClient->m_config.exchangeMTU && !skipMTU) {
                     pClient->exchangeMTU();
                 }
                 // return as we may have a task waiting on the connection completion
@@ -1139,6 +2422,7 @@ int NimBLEClient::handleGapEvent(struct ble_gap_event* event, void* arg) {
 
                 if (pClient->m_config.asyncConnect) {
                     pClient->m_pClientCallbacks->onConnectFail(pClient, rc);
+                    pClient->completeConnectAsync(rc);
                     if (pClient->m_config.deleteOnConnectFail) {
                         NimBLEDevice::deleteClient(pClient);
                     }
@@ -1173,12 +2457,18 @@ int NimBLEClient::handleGapEvent(struct ble_gap_event* event, void* arg) {
 
             NIMBLE_LOGD(LOG_TAG, "Notify Received for handle: %d", event->notify_rx.attr_handle);
 
-            NimBLERemoteCharacteristic* pChr = pClient->getCharacteristic(event->notify_rx.attr_handle);
+            bool                        serviceChanged = false;
+            NimBLERemoteCharacteristic* pChr           = pClient->getNotifyTarget(event->notify_rx.attr_handle,
+                                                                        &serviceChanged);
             if (pChr == nullptr) {
                 NIMBLE_LOGW(LOG_TAG, "unknown handle: %d", event->notify_rx.attr_handle);
                 return BLE_ATT_ERR_INVALID_HANDLE;
             }
 
+            if (serviceChanged) {
+                pClient->invalidateAttributeCache();
+            }
+
             auto len = event->notify_rx.om->om_len;
             if (pChr->m_value.setValue(event->notify_rx.om->om_data, len)) {
                 os_mbuf* next;
@@ -1201,7 +2491,13 @@ int NimBLEClient::handleGapEvent(struct ble_gap_event* event, void* arg) {
                 return rc;
             }
 
-            if (pChr->m_notifyCallback != nullptr) {
+            if (pChr->m_notifyFn != nullptr) {
+                pChr->m_notifyFn(pChr,
+                                 pChr->m_value.getValue().data(),
+                                 pChr->m_value.length(),
+                                 !event->notify_rx.indication,
+                                 pChr->m_notifyCtx);
+            } else if (pChr->m_notifyCallback != nullptr) {
                 // TODO: change this callback to use the NimBLEAttValue class instead of raw data and length
                 pChr->m_notifyCallback(pChr,
                                        const_cast<uint8_t*>(pChr->m_value.getValue().data()),
@@ -1255,6 +2551,13 @@ int NimBLEClient::handleGapEvent(struct ble_gap_event* event, void* arg) {
             }
 
             if (event->conn_update.status == 0) {
+                ble_gap_conn_desc desc;
+                if (ble_gap_conn_find(event->conn_update.conn_handle, &desc) == 0) {
+                    pClient->m_linkProfile.connInterval       = desc.conn_itvl;
+                    pClient->m_linkProfile.connLatency        = desc.conn_latency;
+                    pClient->m_linkProfile.supervisionTimeout = desc.supervision_timeout;
+                }
+
                 NIMBLE_LOGI(LOG_TAG, "Connection parameters updated.");
             } else {
                 NIMBLE_LOGE(LOG_TAG, "Update connection parameters failed.");
@@ -1287,7 +2590,9 @@ int NimBLEClient::handleGapEvent(struct ble_gap_event* event, void* arg) {
                         pClient->secureConnection(true);
                     }
                 } else {
-                    pClient->m_asyncSecureAttempt = 0;
+                    pClient->m_asyncSecureAttempt    = 0;
+                    pClient->m_linkProfile.encrypted = peerInfo.isEncrypted();
+                    pClient->m_linkProfile.bonded    = peerInfo.isBonded();
                     pClient->m_pClientCallbacks->onAuthenticationComplete(peerInfo);
                 }
             }
@@ -1331,10 +2636,30 @@ int NimBLEClient::handleGapEvent(struct ble_gap_event* event, void* arg) {
                 return BLE_ATT_ERR_INVALID_HANDLE;
             }
 
+            if (event->phy_updated.status == 0) {
+                pClient->m_linkProfile.txPhy = event->phy_updated.tx_phy;
+                pClient->m_linkProfile.rxPhy = event->phy_updated.rx_phy;
+            }
+
             pClient->m_pClientCallbacks->onPhyUpdate(pClient, event->phy_updated.tx_phy, event->phy_updated.rx_phy);
             return 0;
         } // BLE_GAP_EVENT_PHY_UPDATE_COMPLETE
 
+# ifdef BLE_GAP_EVENT_DATA_LEN_CHG
+        case BLE_GAP_EVENT_DATA_LEN_CHG: {
+            if (pClient->m_connHandle != event->data_len_chg.conn_handle) {
+                return 0;
+            }
+
+            if (pClient->completeConnectEstablished()) {
+                pTaskData = nullptr;
+            }
+
+            pClient->m_linkProfile.txOctets = event->data_len_chg.max_tx_octets;
+            return 0;
+        } // BLE_GAP_EVENT_DATA_LEN_CHG
+# endif
+
         case BLE_GAP_EVENT_MTU: {
             if (pClient->m_connHandle != event->mtu.conn_handle) {
                 return 0;
@@ -1345,6 +2670,7 @@ int NimBLEClient::handleGapEvent(struct ble_gap_event* event, void* arg) {
             }
 
             NIMBLE_LOGI(LOG_TAG, "mtu update: mtu=%d", event->mtu.value);
+            pClient->m_linkProfile.mtu = event->mtu.value;
             pClient->m_pClientCallbacks->onMTUChange(pClient, event->mtu.value);
             rc = 0;
             break;
@@ -30,6 +30,8 @@
 # include "NimBLEAddress.h"
 
 # include <stdint.h>
+# include <array>
+# include <functional>
 # include <vector>
 # include <string>
 
@@ -41,6 +43,7 @@ class NimBLEAdvertisedDevice;
 class NimBLEAttValue;
 class NimBLEClientCallbacks;
 class NimBLEConnInfo;
+class NimBLEAttributeCacheStore;
 struct NimBLETaskData;
 
 /**
@@ -48,6 +51,12 @@ struct NimBLETaskData;
  */
 class NimBLEClient {
   public:
+    /**
+     * @brief Completion callback of the asynchronous client operations.
+     * @details Called from the host task with the client and the result code, 0 on success.
+     */
+    typedef std::function<void(NimBLEClient* pClient, int rc)> completion_callback;
+
 # if MYNEWT_VAL(BLE_ROLE_OBSERVER)
     bool connect(const NimBLEAdvertisedDevice* device,
                  bool                          deleteAttributes = true,
@@ -72,7 +81,17 @@ class NimBLEClient {
     bool           secureConnection(bool async = false) const;
     void           setConnectTimeout(uint32_t timeout);
     bool           setDataLen(uint16_t txOctets);
+    void           setLinkProfileReuse(bool reuse);
+    void           clearLinkProfile();
+    bool           connectAsync(const NimBLEAddress& address,
+                                completion_callback  callback,
+                                bool                 deleteAttributes = true,
+                                bool                 exchangeMTU      = true);
     bool           discoverAttributes();
+    bool           discoverAttributesAsync(completion_callback callback);
+    void           setAttributeCache(NimBLEAttributeCacheStore* pStore);
+    bool           saveAttributeCache();
+    bool           clearAttributeCache();
     NimBLEConnInfo getConnInfo() const;
     int            getLastError() const;
     bool           updateConnParams(uint16_t minInterval, uint16_t maxInterval, uint16_t latency, uint16_t timeout);
@@ -95,6 +114,11 @@ class NimBLEClient {
                             const NimBLEUUID&     characteristicUUID,
                             const NimBLEAttValue& value,
                             bool                  response = false);
+    bool           readValues(const std::vector<NimBLERemoteCharacteristic*>& chars,
+                              std::vector<NimBLEAttValue>*                    pValues = nullptr);
+    bool           readValues(const std::vector<NimBLERemoteCharacteristic*>& chars,
+                              const std::vector<uint16_t>&                    lengths,
+                              std::vector<NimBLEAttValue>*                    pValues = nullptr);
 
 # if MYNEWT_VAL(BLE_EXT_ADV)
     void setConnectPhy(uint8_t phyMask);
@@ -109,6 +133,7 @@ class NimBLEClient {
         uint8_t asyncConnect : 1;        // Connect asynchronously.
         uint8_t exchangeMTU : 1;         // Exchange MTU after connection.
         uint8_t connectFailRetries : 3;  // Number of retries for 0x3e (connection establishment) failures.
+        uint8_t reuseLinkProfile : 1;    // Apply the link profile of the last connection when reconnecting.
 
         /**
          * @brief Construct a new Config object with default values.
@@ -119,6 +144,7 @@ class NimBLEClient {
          * - asyncConnect: false
          * - exchangeMTU: true
          * - connectFailRetries: 2
+         * - reuseLinkProfile: false
          */
         Config()
             : deleteCallbacks(0),
@@ -126,11 +152,33 @@ class NimBLEClient {
               deleteOnConnectFail(0),
               asyncConnect(0),
               exchangeMTU(1),
-              connectFailRetries(2) {}
+              connectFailRetries(2),
+              reuseLinkProfile(0) {}
     };
 
-    Config getConfig() const;
-    void   setConfig(Config config);
+    /**
+     * @brief The link parameters negotiated with the peer, applied in one go on reconnection.
+     * @details Zero values are unknown, the time saved by a reconnection with the profile is
+     * baselineTimeMs - connectTimeMs.
+     */
+    struct LinkProfile {
+        uint16_t mtu{0};                // ATT MTU of the last exchange.
+        uint16_t txOctets{0};           // Maximum TX payload octets of the last data length change.
+        uint8_t  txPhy{0};              // TX PHY of the last PHY update, BLE_GAP_LE_PHY_1M/2M/CODED.
+        uint8_t  rxPhy{0};              // RX PHY of the last PHY update.
+        uint16_t connInterval{0};       // Connection interval in 1.25ms units.
+        uint16_t connLatency{0};        // Peripheral latency in connection events.
+        uint16_t supervisionTimeout{0}; // Supervision timeout in 10ms units.
+        bool     encrypted{false};      // The link was encrypted.
+        bool     bonded{false};         // The link was encrypted with a bond.
+        bool     valid{false};          // A connection to the peer has been made since the profile was cleared.
+        uint32_t connectTimeMs{0};      // Time from connect() to the connection being established, last connection.
+        uint32_t baselineTimeMs{0};     // Same as connectTimeMs for the last connection made without the profile.
+    };
+
+    Config             getConfig() const;
+    void               setConfig(Config config);
+    const LinkProfile& getLinkProfile() const;
 
   private:
     enum ConnStatus : uint8_t { CONNECTED, DISCONNECTED, CONNECTING, DISCONNECTING };
@@ -146,11 +194,62 @@ class NimBLEClient {
     static void connectEstablishedTimerCb(struct ble_npl_event* event);
     void        startConnectEstablishedTimer(uint16_t connInterval);
     bool        completeConnectEstablished();
+    void        completeConnectAsync(int rc);
+    void        applyLinkProfile();
+    int         adoptConnection(struct ble_gap_event* event, bool exchangeMTU, completion_callback callback);
+    NimBLERemoteCharacteristic* getNotifyTarget(uint16_t handle, bool* pServiceChanged);
+    void                        removeNotifyTarget(uint16_t handle);
     static int  exchangeMTUCb(uint16_t conn_handle, const ble_gatt_error* error, uint16_t mtu, void* arg);
     static int  serviceDiscoveredCB(uint16_t                     connHandle,
                                     const struct ble_gatt_error* error,
                                     const struct ble_gatt_svc*   service,
                                     void*                        arg);
+    struct DiscoveryState;
+    static int  discoverySvcCB(uint16_t                     connHandle,
+                               const struct ble_gatt_error* error,
+                               const struct ble_gatt_svc*   service,
+                               void*                        arg);
+    static int  discoveryChrCB(uint16_t                     connHandle,
+                               const struct ble_gatt_error* error,
+                               const struct ble_gatt_chr*   chr,
+                               void*                        arg);
+    static int  discoveryDscCB(uint16_t                     connHandle,
+                               const struct ble_gatt_error* error,
+                               uint16_t                     chrHandle,
+                               const struct ble_gatt_dsc*   dsc,
+                               void*                        arg);
+    static int  discoverNextDescriptors(DiscoveryState* pState);
+    static void completeDiscovery(DiscoveryState* pState, int rc);
+    bool        readMultiple(const std::vector<NimBLERemoteCharacteristic*>& chars,
+                             const std::vector<uint16_t>*                    pLengths,
+                             std::vector<NimBLEAttValue>*                    pValues);
+    int         readMultipleBatch(const uint16_t*              handles,
+                                  uint8_t                      count,
+                                  bool                         variable,
+                                  std::vector<NimBLEAttValue>& values);
+    static int  readMultCB(uint16_t                     connHandle,
+                           const struct ble_gatt_error* error,
+                           struct ble_gatt_attr*        attr,
+                           void*                        arg);
+# if MYNEWT_VAL(BLE_GATT_READ_MULT_VAR)
+    static int  readMultVarCB(uint16_t                     connHandle,
+                              const struct ble_gatt_error* error,
+                              struct ble_gatt_attr*        attrs,
+                              uint8_t                      numAttrs,
+                              void*                        arg);
+# endif
+    bool        getPeerIdentity(NimBLEAddress& peerId) const;
+    bool        restoreAttributeCache(bool readHash = true);
+    bool        storeAttributeCache(const NimBLEAddress& peerId, bool defer = false);
+    bool        flushAttributeCache(bool* pHadPending = nullptr);
+    void        invalidateAttributeCache();
+    void        serializeAttributes(std::vector<uint8_t>& data) const;
+    bool        deserializeAttributes(const std::vector<uint8_t>& data);
+    bool        readDatabaseHash(std::array<uint8_t, 16>& hash);
+    static int  databaseHashReadCB(uint16_t                     connHandle,
+                                   const struct ble_gatt_error* error,
+                                   struct ble_gatt_attr*        attr,
+                                   void*                        arg);
 
     NimBLEAddress                     m_peerAddress;
     mutable int                       m_lastErr;
@@ -166,14 +265,39 @@ class NimBLEClient {
     ble_npl_callout                   m_connectEstablishedTimer{};
     bool                              m_connectCallbackPending;
     uint8_t                           m_connectFailRetryCount;
+    completion_callback               m_connectCb;
+    NimBLEAttributeCacheStore*        m_pAttCache{nullptr};
+    uint32_t                          m_attCacheSig{0};
+    std::vector<uint8_t>              m_attCachePending{};
+    NimBLEAddress                     m_attCachePendingPeer{};
+    std::array<uint8_t, 16>           m_dbHash{};
+    uint8_t                           m_attCacheChecked : 1;
+    uint8_t                           m_attCacheInvalid : 1;
+    uint8_t                           m_attComplete : 1;
+    uint8_t                           m_dbHashValid : 1;
+    uint8_t                           m_linkProfileApplied : 1;
+    bool                              m_discoveryPending{false};
+    LinkProfile                       m_linkProfile{};
+    ble_npl_time_t                    m_connectStart{0};
 
 # if MYNEWT_VAL(BLE_EXT_ADV)
     uint8_t m_phyMask;
 # endif
     ble_gap_conn_params m_connParams;
 
+    /** @brief Notification routing entry, sorted by value handle. */
+    struct NotifyEntry {
+        uint16_t                    handle;
+        bool                        serviceChanged;
+        NimBLERemoteCharacteristic* pChr;
+    };
+
+    std::vector<NotifyEntry> m_notifyTable{};
+
     friend class NimBLEDevice;
     friend class NimBLEServer;
+    friend class NimBLERemoteCharacteristic;
+    friend class NimBLECentralManager;
 }; // class NimBLEClient
 
 /**
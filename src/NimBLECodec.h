@@ -0,0 +1,242 @@
+/*
+ * Copyright 2020-2025 Ryan Powell <ryan@nable-embedded.io> and
+ * esp-nimble-cpp, NimBLE-Arduino contributors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NIMBLE_CPP_CODEC_H_
+#define NIMBLE_CPP_CODEC_H_
+
+#include "syscfg/syscfg.h"
+#if CONFIG_BT_NIMBLE_ENABLED
+
+# include <array>
+# include <cstddef>
+# include <cstdint>
+# include <cstring>
+# include <type_traits>
+
+# ifndef BLE_ATT_ATTR_MAX_LEN
+#  define BLE_ATT_ATTR_MAX_LEN 512
+# endif
+
+/**
+ * @brief The byte order used to serialize a multi-byte field.
+ * @details Bluetooth SIG defined characteristics are little endian, big endian is provided
+ * for vendor specific payloads that require it.
+ */
+enum class NimBLEByteOrder : uint8_t { LittleEndian, BigEndian };
+
+/**
+ * @brief Describes a single fixed size field of a characteristic payload.
+ * @tparam T The field type, must be an integral, enum or floating point type.
+ * @tparam Order The byte order of the field on the wire, defaults to little endian.
+ * @details Values are serialized byte by byte, so the payload buffer does not need to be aligned
+ * and the result is independent of the host byte order.
+ */
+template <typename T, NimBLEByteOrder Order = NimBLEByteOrder::LittleEndian>
+class NimBLEField {
+    static_assert(std::is_integral<T>::value || std::is_enum<T>::value || std::is_floating_point<T>::value,
+                  "NimBLEField type must be an integral, enum or floating point type");
+    static_assert(sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4 || sizeof(T) == 8,
+                  "NimBLEField type must be 1, 2, 4 or 8 bytes");
+
+    using raw_type = typename std::conditional<
+        sizeof(T) == 1,
+        uint8_t,
+        typename std::conditional<sizeof(T) == 2, uint16_t, typename std::conditional<sizeof(T) == 4, uint32_t, uint64_t>::type>::type>::type;
+
+    static raw_type toRaw(const T& v, std::false_type) { return static_cast<raw_type>(v); }
+    static raw_type toRaw(const T& v, std::true_type) {
+        raw_type raw;
+        memcpy(&raw, &v, sizeof(raw));
+        return raw;
+    }
+
+    static T fromRaw(raw_type raw, std::false_type) { return static_cast<T>(raw); }
+    static T fromRaw(raw_type raw, std::true_type) {
+        T v;
+        memcpy(&v, &raw, sizeof(v));
+        return v;
+    }
+
+  public:
+    using type = T;
+
+    /** @brief The number of bytes the field occupies in the payload. */
+    static constexpr size_t size() { return sizeof(T); }
+
+    /**
+     * @brief Write the field to a buffer.
+     * @param [in] buf The buffer to write to, must have at least size() bytes available.
+     * @param [in] v The value to write.
+     */
+    static void encode(uint8_t* buf, const T& v) {
+        raw_type raw = toRaw(v, std::is_floating_point<T>{});
+        for (size_t i = 0; i < sizeof(T); i++) {
+            const size_t pos = (Order == NimBLEByteOrder::LittleEndian) ? i : sizeof(T) - 1 - i;
+            buf[pos]         = static_cast<uint8_t>(raw >> (8 * i));
+        }
+    }
+
+    /**
+     * @brief Read the field from a buffer.
+     * @param [in] buf The buffer to read from, must have at least size() bytes available.
+     * @param [out] v The value read.
+     */
+    static void decode(const uint8_t* buf, T& v) {
+        raw_type raw = 0;
+        for (size_t i = 0; i < sizeof(T); i++) {
+            const size_t pos  = (Order == NimBLEByteOrder::LittleEndian) ? i : sizeof(T) - 1 - i;
+            raw              |= static_cast<raw_type>(static_cast<raw_type>(buf[pos]) << (8 * i));
+        }
+        v = fromRaw(raw, std::is_floating_point<T>{});
+    }
+}; // NimBLEField
+
+/**
+ * @brief Describes a fixed length array of raw bytes in a characteristic payload, such as an address or key.
+ * @tparam N The number of bytes.
+ */
+template <size_t N>
+class NimBLEFieldBytes {
+  public:
+    using type = std::array<uint8_t, N>;
+
+    /** @brief The number of bytes the field occupies in the payload. */
+    static constexpr size_t size() { return N; }
+
+    /**
+     * @brief Write the field to a buffer.
+     * @param [in] buf The buffer to write to, must have at least N bytes available.
+     * @param [in] v The bytes to write.
+     */
+    static void encode(uint8_t* buf, const type& v) { memcpy(buf, v.data(), N); }
+
+    /**
+     * @brief Read the field from a buffer.
+     * @param [in] buf The buffer to read from, must have at least N bytes available.
+     * @param [out] v The bytes read.
+     */
+    static void decode(const uint8_t* buf, type& v) { memcpy(v.data(), buf, N); }
+}; // NimBLEFieldBytes
+
+/**
+ * @brief A compile time description of a packed characteristic payload.
+ * @tparam Fields The NimBLEField / NimBLEFieldBytes types that make up the payload, in wire order.
+ * @details The payload size and field offsets are resolved at compile time, encoding and decoding
+ * compile down to byte stores and loads with a single length check.\n
+ * <b>Example:</b>
+ * @code
+ * // Heart rate style payload: flags, uint16 measurement, int16 energy, big endian vendor counter.
+ * using HrPayload = NimBLESchema<NimBLEField<uint8_t>,
+ *                                NimBLEField<uint16_t>,
+ *                                NimBLEField<int16_t>,
+ *                                NimBLEField<uint32_t, NimBLEByteOrder::BigEndian>>;
+ *
+ * pChr->notifyFields<HrPayload>(0x01, 72, -3, counter);
+ *
+ * uint8_t flags; uint16_t bpm; int16_t energy; uint32_t cnt;
+ * if (pRemoteChr->readFields<HrPayload>(flags, bpm, energy, cnt)) { ... }
+ * @endcode
+ */
+template <typename... Fields>
+class NimBLESchema;
+
+/** @cond */
+template <>
+class NimBLESchema<> {
+  public:
+    static constexpr size_t size() { return 0; }
+    static void             encodeFields(uint8_t*) {}
+    static void             decodeFields(const uint8_t*) {}
+};
+/** @endcond */
+
+template <typename First, typename... Rest>
+class NimBLESchema<First, Rest...> {
+    template <typename...>
+    friend class NimBLESchema;
+
+    /** @brief Encode the fields without a length check, the caller guarantees size() bytes are available. */
+    static void encodeFields(uint8_t* buf, const typename First::type& v, const typename Rest::type&... rest) {
+        First::encode(buf, v);
+        NimBLESchema<Rest...>::encodeFields(buf + First::size(), rest...);
+    }
+
+    /** @brief Decode the fields without a length check, the caller guarantees size() bytes are available. */
+    static void decodeFields(const uint8_t* buf, typename First::type& v, typename Rest::type&... rest) {
+        First::decode(buf, v);
+        NimBLESchema<Rest...>::decodeFields(buf + First::size(), rest...);
+    }
+
+  public:
+    /** @brief The total number of bytes of the payload. */
+    static constexpr size_t size() { return First::size() + NimBLESchema<Rest...>::size(); }
+
+    static_assert(First::size() + NimBLESchema<Rest...>::size() <= BLE_ATT_ATTR_MAX_LEN,
+                  "NimBLESchema payload exceeds the maximum attribute length");
+
+    /** @brief A buffer type sized to hold the encoded payload. */
+    using buffer_type = std::array<uint8_t, First::size() + NimBLESchema<Rest...>::size()>;
+
+    /**
+     * @brief Encode the field values into a buffer.
+     * @param [in] buf The buffer to write to.
+     * @param [in] len The length of the buffer in bytes.
+     * @param [in] v, rest The field values, in schema order.
+     * @return True if the buffer was large enough and the values were written.
+     */
+    static bool encode(uint8_t* buf, size_t len, const typename First::type& v, const typename Rest::type&... rest) {
+        if (buf == nullptr || len < size()) {
+            return false;
+        }
+
+        encodeFields(buf, v, rest...);
+        return true;
+    }
+
+    /**
+     * @brief Encode the field values into a new buffer.
+     * @param [in] v, rest The field values, in schema order.
+     * @return A buffer of exactly size() bytes containing the encoded payload.
+     */
+    static buffer_type pack(const typename First::type& v, const typename Rest::type&... rest) {
+        buffer_type buf;
+        encodeFields(buf.data(), v, rest...);
+        return buf;
+    }
+
+    /**
+     * @brief Decode the field values from a buffer.
+     * @param [in] buf The buffer to read from.
+     * @param [in] len The length of the buffer in bytes.
+     * @param [out] v, rest References to the variables to receive the field values, in schema order.
+     * @return True if the buffer contained at least size() bytes and the values were read,
+     * on failure the output variables are not modified.
+     * @details Trailing bytes beyond size() are ignored so that payloads can be extended later
+     * without breaking older readers.
+     */
+    static bool decode(const uint8_t* buf, size_t len, typename First::type& v, typename Rest::type&... rest) {
+        if (buf == nullptr || len < size()) {
+            return false;
+        }
+
+        decodeFields(buf, v, rest...);
+        return true;
+    }
+}; // NimBLESchema
+
+#endif // CONFIG_BT_NIMBLE_ENABLED
+#endif // NIMBLE_CPP_CODEC_H_
@@ -0,0 +1,261 @@
+/*
+ * Copyright 2020-2025 Ryan Powell <ryan@nable-embedded.io> and
+ * esp-nimble-cpp, NimBLE-Arduino contributors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NIMBLE_CPP_COROUTINE_H_
+#define NIMBLE_CPP_COROUTINE_H_
+
+#include "syscfg/syscfg.h"
+#if CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_CENTRAL) && defined(__cpp_impl_coroutine)
+
+# include "NimBLEClient.h"
+# include "NimBLERemoteCharacteristic.h"
+# include "NimBLEAttValue.h"
+
+# include <atomic>
+# include <coroutine>
+# include <cstdlib>
+
+/*
+ * C++20 coroutine support for client workflows.
+ *
+ * Each awaitable starts one of the non-blocking client operations and suspends the coroutine until its
+ * completion callback runs on the host task. An operation that completes before its start call returns, such as
+ * a discovery restored from the attribute cache, does not suspend and continues on the calling task. A flow
+ * across many peripherals can then be written as sequential code in one NimBLECoTask per peripheral instead
+ * of a FreeRTOS task with its own stack each.
+ *
+ * By default the coroutine is resumed directly on the host task, so the code between two co_await
+ * expressions must not call the blocking APIs (connect, readValue, writeValue, ...). Set an executor
+ * with NimBLECoro::setExecutor to resume the coroutines on an application task or event queue instead.
+ *
+ * Example:
+ * @code
+ * NimBLECoTask provision(NimBLEClient* pClient, NimBLEAddress addr) {
+ *     if (co_await NimBLECoro::connect(pClient, addr) != 0) {
+ *         co_return;
+ *     }
+ *
+ *     if (co_await NimBLECoro::discover(pClient) == 0) {
+ *         auto pChr = pClient->getService(svcUuid)->getCharacteristic(chrUuid);
+ *         auto res  = co_await NimBLECoro::read(pChr);
+ *         if (res.rc == 0) {
+ *             co_await NimBLECoro::write(pChr, res.value.data(), res.value.size());
+ *         }
+ *     }
+ *
+ *     pClient->disconnect();
+ * }
+ * @endcode
+ */
+
+/**
+ * @brief The return type of a detached client coroutine.
+ * @details The coroutine starts running immediately when called and its frame is freed when it returns.
+ * It cannot be awaited, a flow that needs the result of another should pass a callback or shared state.
+ */
+class NimBLECoTask {
+  public:
+    struct promise_type {
+        NimBLECoTask        get_return_object() { return NimBLECoTask{}; }
+        std::suspend_never  initial_suspend() noexcept { return {}; }
+        std::suspend_never  final_suspend() noexcept { return {}; }
+        void                return_void() {}
+        void                unhandled_exception() { abort(); }
+    };
+}; // NimBLECoTask
+
+/**
+ * @brief The result of an awaited read.
+ */
+struct NimBLECoReadResult {
+    int            rc{0};
+    NimBLEAttValue value{};
+};
+
+/**
+ * @brief Factory of the awaitable client operations and the resumption executor.
+ */
+class NimBLECoro {
+  public:
+    /**
+     * @brief A function that resumes a suspended coroutine, called from the host task.
+     * @details The executor must call handle.resume() exactly once, for example after posting
+     * the handle to a queue served by an application task.
+     */
+    typedef void (*executor_t)(std::coroutine_handle<> handle);
+
+    /**
+     * @brief Set the executor used to resume the coroutines.
+     * @param [in] executor The executor, nullptr to resume directly on the host task.
+     */
+    static void setExecutor(executor_t executor) { m_executor = executor; }
+
+    /**
+     * @brief Awaitable of a single operation started with a completion callback.
+     * @tparam Result The value of the co_await expression.
+     * @tparam Start Callable taking the awaitable and returning true if the operation was started.
+     */
+    template <typename Result, typename Start>
+    class Operation {
+      public:
+        explicit Operation(Start start) : m_start{std::move(start)} {}
+
+        bool await_ready() const noexcept { return false; }
+
+        /**
+         * @brief Start the operation, the coroutine is resumed by complete().
+         * @return False if the operation could not be started or has already completed, the coroutine then
+         * continues immediately.
+         * @details The completion callback may already run on the host task before this returns, so the
+         * members are only accessed through the state exchange once the operation has started.
+         */
+        bool await_suspend(std::coroutine_handle<> handle) {
+            m_handle = handle;
+            if (!m_start(*this)) {
+                setRc(m_result, BLE_HS_EUNKNOWN);
+                return false;
+            }
+
+            // If complete() ran before the start returned the coroutine continues here instead of being resumed
+            // inside the start call, where the frame holding this operation would be destroyed under it.
+            uint8_t expected = STARTING;
+            return m_state.compare_exchange_strong(expected, SUSPENDED);
+        }
+
+        Result await_resume() { return std::move(m_result); }
+
+        /** @brief Store the result and resume the awaiting coroutine. */
+        void complete(int rc) {
+            setRc(m_result, rc);
+            uint8_t expected = STARTING;
+            if (!m_state.compare_exchange_strong(expected, DONE)) {
+                NimBLECoro::resume(m_handle);
+            }
+        }
+
+        Result m_result{};
+
+      private:
+        static void setRc(int& result, int rc) { result = rc; }
+        static void setRc(NimBLECoReadResult& result, int rc) { result.rc = rc; }
+
+        enum : uint8_t { STARTING, SUSPENDED, DONE };
+
+        Start                   m_start;
+        std::coroutine_handle<> m_handle{};
+        std::atomic<uint8_t>    m_state{STARTING};
+    }; // Operation
+
+    /**
+     * @brief Connect to a server.
+     * @param [in] pClient The client to connect.
+     * @param [in] address The address of the server.
+     * @return An awaitable producing the result code, 0 once the connection is established.
+     */
+    static auto connect(NimBLEClient* pClient, const NimBLEAddress& address) {
+        return makeOperation<int>([pClient, address](auto& op) {
+            return pClient->connectAsync(address, [&op](NimBLEClient*, int rc) { op.complete(rc); });
+        });
+    }
+
+    /**
+     * @brief Discover the full attribute database of the connected server.
+     * @param [in] pClient The connected client.
+     * @return An awaitable producing the result code.
+     */
+    static auto discover(NimBLEClient* pClient) {
+        return makeOperation<int>([pClient](auto& op) {
+            return pClient->discoverAttributesAsync([&op](NimBLEClient*, int rc) { op.complete(rc); });
+        });
+    }
+
+    /**
+     * @brief Read the value of a remote characteristic or descriptor.
+     * @param [in] pAttr The attribute to read.
+     * @return An awaitable producing a NimBLECoReadResult.
+     */
+    static auto read(NimBLERemoteValueAttribute* pAttr) {
+        return makeOperation<NimBLECoReadResult>([pAttr](auto& op) {
+            return pAttr->readValueAsync([&op](NimBLERemoteValueAttribute*, const NimBLEAttValue& value, int rc) {
+                op.m_result.value = value;
+                op.complete(rc);
+            });
+        });
+    }
+
+    /**
+     * @brief Write the value of a remote characteristic or descriptor with response.
+     * @param [in] pAttr The attribute to write.
+     * @param [in] data The data to write, must remain valid until the write has been started.
+     * @param [in] length The number of bytes to write.
+     * @return An awaitable producing the result code.
+     */
+    static auto write(const NimBLERemoteValueAttribute* pAttr, const uint8_t* data, size_t length) {
+        return makeOperation<int>([pAttr, data, length](auto& op) {
+            return pAttr->writeValueAsync(data, length, [&op](NimBLERemoteValueAttribute*, int rc) {
+                op.complete(rc);
+            });
+        });
+    }
+
+    /**
+     * @brief Subscribe for notifications or indications.
+     * @param [in] pChr The characteristic to subscribe to.
+     * @param [in] notifications If true, subscribe for notifications, false subscribe for indications.
+     * @param [in] notifyCallback A callback to be invoked for a notification.
+     * @return An awaitable producing the result code of the descriptor write.
+     */
+    static auto subscribe(const NimBLERemoteCharacteristic*           pChr,
+                          bool                                        notifications,
+                          NimBLERemoteCharacteristic::notify_callback notifyCallback) {
+        return makeOperation<int>([pChr, notifications, notifyCallback](auto& op) {
+            return pChr->subscribeAsync(notifications, notifyCallback, [&op](NimBLERemoteValueAttribute*, int rc) {
+                op.complete(rc);
+            });
+        });
+    }
+
+    /**
+     * @brief Unsubscribe for notifications or indications.
+     * @param [in] pChr The characteristic to unsubscribe from.
+     * @return An awaitable producing the result code of the descriptor write.
+     */
+    static auto unsubscribe(const NimBLERemoteCharacteristic* pChr) {
+        return makeOperation<int>([pChr](auto& op) {
+            return pChr->unsubscribeAsync([&op](NimBLERemoteValueAttribute*, int rc) { op.complete(rc); });
+        });
+    }
+
+  private:
+    template <typename Result, typename Start>
+    static Operation<Result, Start> makeOperation(Start start) {
+        return Operation<Result, Start>(std::move(start));
+    }
+
+    static void resume(std::coroutine_handle<> handle) {
+        if (m_executor != nullptr) {
+            m_executor(handle);
+        } else {
+            handle.resume();
+        }
+    }
+
+    static inline executor_t m_executor{nullptr};
+}; // NimBLECoro
+
+#endif // CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_CENTRAL) && defined(__cpp_impl_coroutine)
+#endif // NIMBLE_CPP_COROUTINE_H_
@@ -256,6 +256,7 @@ class NimBLEDevice {
 
 # if MYNEWT_VAL(BLE_ROLE_CENTRAL)
     friend class NimBLEClient;
+    friend class NimBLECentralManager;
 # endif
 
 # if MYNEWT_VAL(BLE_ROLE_OBSERVER)
@@ -281,6 +282,9 @@ class NimBLEDevice {
 #  include "NimBLERemoteService.h"
 #  include "NimBLERemoteCharacteristic.h"
 #  include "NimBLERemoteDescriptor.h"
+#  include "NimBLEAttributeCache.h"
+#  include "NimBLECoroutine.h"
+#  include "NimBLECentralManager.h"
 # endif
 
 # if MYNEWT_VAL(BLE_ROLE_OBSERVER)
@@ -292,6 +296,7 @@ class NimBLEDevice {
 #  include "NimBLEService.h"
 #  include "NimBLECharacteristic.h"
 #  include "NimBLEDescriptor.h"
+#  include "NimBLEGattTable.h"
 #  if MYNEWT_VAL(BLE_L2CAP_COC_MAX_NUM)
 #   include "NimBLEL2CAPServer.h"
 #   include "NimBLEL2CAPChannel.h"
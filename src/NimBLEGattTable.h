@@ -0,0 +1,141 @@
+/*
+ * Copyright 2020-2025 Ryan Powell <ryan@nable-embedded.io> and
+ * esp-nimble-cpp, NimBLE-Arduino contributors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NIMBLE_CPP_GATT_TABLE_H_
+#define NIMBLE_CPP_GATT_TABLE_H_
+
+#include "syscfg/syscfg.h"
+#if CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_PERIPHERAL)
+
+# ifdef USING_NIMBLE_ARDUINO_HEADERS
+#  include "nimble/nimble/host/include/host/ble_gatt.h"
+# else
+#  include "host/ble_gatt.h"
+# endif
+
+/*
+ * Helpers to declare fixed GATT tables at compile time.
+ *
+ * The tables are plain NimBLE definitions, when declared `static const` with constant arguments they are
+ * placed in flash and registered with NimBLEServer::addStaticServices without creating any NimBLEService,
+ * NimBLECharacteristic or NimBLEDescriptor objects or copying the definitions to the heap.
+ * Attribute access is handled by the NimBLE access callbacks given in the definitions.
+ *
+ * Example:
+ * @code
+ * static const ble_uuid16_t hrsUuid = BLE_UUID16_INIT(0x180D);
+ * static const ble_uuid16_t hrmUuid = BLE_UUID16_INIT(0x2A37);
+ * static uint16_t           hrmHandle;
+ *
+ * static const ble_gatt_chr_def hrsChrs[] = {
+ *     NimBLEGattCharacteristic(&hrmUuid.u, BLE_GATT_CHR_F_NOTIFY | BLE_GATT_CHR_F_READ, hrmAccess, nullptr, &hrmHandle),
+ *     NimBLEGattCharacteristicEnd()};
+ *
+ * static const ble_gatt_svc_def gattSvcs[] = {NimBLEGattService(&hrsUuid.u, hrsChrs), NimBLEGattServiceEnd()};
+ *
+ * NimBLEDevice::createServer()->addStaticServices(gattSvcs);
+ * @endcode
+ */
+
+# if __cplusplus >= 201402L
+#  define NIMBLE_CPP_GATT_TABLE_CONSTEXPR constexpr
+# else
+#  define NIMBLE_CPP_GATT_TABLE_CONSTEXPR inline
+# endif
+
+/**
+ * @brief Define a service of a static GATT table.
+ * @param [in] uuid The service UUID, must have static storage duration.
+ * @param [in] characteristics The characteristic table of the service, terminated by NimBLEGattCharacteristicEnd().
+ * @param [in] type BLE_GATT_SVC_TYPE_PRIMARY or BLE_GATT_SVC_TYPE_SECONDARY.
+ * @return The service definition.
+ */
+NIMBLE_CPP_GATT_TABLE_CONSTEXPR ble_gatt_svc_def NimBLEGattService(const ble_uuid_t*       uuid,
+                                                                   const ble_gatt_chr_def* characteristics,
+                                                                   uint8_t                 type = BLE_GATT_SVC_TYPE_PRIMARY) {
+    ble_gatt_svc_def def{};
+    def.type            = type;
+    def.uuid            = uuid;
+    def.characteristics = characteristics;
+    return def;
+}
+
+/** @brief The terminating entry of a service table. */
+NIMBLE_CPP_GATT_TABLE_CONSTEXPR ble_gatt_svc_def NimBLEGattServiceEnd() {
+    return ble_gatt_svc_def{};
+}
+
+/**
+ * @brief Define a characteristic of a static GATT table.
+ * @param [in] uuid The characteristic UUID, must have static storage duration.
+ * @param [in] flags The BLE_GATT_CHR_F_* properties and permissions.
+ * @param [in] accessCb The callback invoked when the value is read or written.
+ * @param [in] arg Optional argument passed to the callback.
+ * @param [out] valHandle Optional location the stack writes the value handle to on registration.
+ * @param [in] descriptors Optional descriptor table, terminated by NimBLEGattDescriptorEnd(), can be `static const`.
+ * @return The characteristic definition.
+ */
+NIMBLE_CPP_GATT_TABLE_CONSTEXPR ble_gatt_chr_def NimBLEGattCharacteristic(
+    const ble_uuid_t*       uuid,
+    ble_gatt_chr_flags      flags,
+    ble_gatt_access_fn*     accessCb,
+    void*                   arg         = nullptr,
+    uint16_t*               valHandle   = nullptr,
+    const ble_gatt_dsc_def* descriptors = nullptr) {
+    ble_gatt_chr_def def{};
+    def.uuid        = uuid;
+    def.access_cb   = accessCb;
+    def.arg         = arg;
+    def.descriptors = const_cast<ble_gatt_dsc_def*>(descriptors); // only read by the stack
+    def.flags       = flags;
+    def.val_handle  = valHandle;
+    return def;
+}
+
+/** @brief The terminating entry of a characteristic table. */
+NIMBLE_CPP_GATT_TABLE_CONSTEXPR ble_gatt_chr_def NimBLEGattCharacteristicEnd() {
+    return ble_gatt_chr_def{};
+}
+
+/**
+ * @brief Define a descriptor of a static GATT table.
+ * @param [in] uuid The descriptor UUID, must have static storage duration.
+ * @param [in] attFlags The BLE_ATT_F_* permissions.
+ * @param [in] accessCb The callback invoked when the descriptor is read or written.
+ * @param [in] arg Optional argument passed to the callback.
+ * @return The descriptor definition.
+ * @details The Client Characteristic Configuration descriptor is added by the stack and must not be defined.
+ */
+NIMBLE_CPP_GATT_TABLE_CONSTEXPR ble_gatt_dsc_def NimBLEGattDescriptor(const ble_uuid_t*   uuid,
+                                                                      uint8_t             attFlags,
+                                                                      ble_gatt_access_fn* accessCb,
+                                                                      void*               arg = nullptr) {
+    ble_gatt_dsc_def def{};
+    def.uuid      = uuid;
+    def.att_flags = attFlags;
+    def.access_cb = accessCb;
+    def.arg       = arg;
+    return def;
+}
+
+/** @brief The terminating entry of a descriptor table. */
+NIMBLE_CPP_GATT_TABLE_CONSTEXPR ble_gatt_dsc_def NimBLEGattDescriptorEnd() {
+    return ble_gatt_dsc_def{};
+}
+
+#endif // CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_PERIPHERAL)
+#endif // NIMBLE_CPP_GATT_TABLE_H_
@@ -50,11 +50,81 @@ typedef enum {
 # include "NimBLELocalAttribute.h"
 # include "NimBLEValueAttribute.h"
 # include "NimBLEAttValue.h"
+# include <functional>
+# include <type_traits>
 # include <vector>
 class NimBLEConnInfo;
 
+/**
+ * @brief Gives a value provider write access to the response of a read request.
+ * @details Data appended is placed directly in the response buffer of the stack,
+ * the stack sends the part of the value that was requested by the peer.\n
+ * The provider must append the complete value for every call. It is called again for each part of a
+ * long read and the stack does not report the offset being read, so the value should not change
+ * between the parts of a long read.
+ */
+class NimBLEReadResponse {
+  public:
+    /**
+     * @brief Append data to the response.
+     * @param [in] data A pointer to the data to append.
+     * @param [in] len The length of the data.
+     * @return True if the data was appended, false if the maximum length of the attribute
+     * would be exceeded or no buffers were available.
+     */
+    bool append(const uint8_t* data, size_t len) {
+        if (m_rc != 0) {
+            return false;
+        }
+
+        if (m_len + len > m_maxLen) {
+            m_rc = BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
+            return false;
+        }
+
+        if (os_mbuf_append(m_om, data, len) != 0) {
+            m_rc = BLE_ATT_ERR_INSUFFICIENT_RES;
+            return false;
+        }
+
+        m_len += len;
+        return true;
+    }
+
+    /**
+     * @brief Template to append a value of a trivially copyable type to the response.
+     * @param [in] v The value to append.
+     * @return True if the value was appended.
+     */
+    template <typename T>
+    typename std::enable_if<std::is_trivially_copyable<T>::value && !std::is_pointer<T>::value, bool>::type append(
+        const T& v) {
+        return append(reinterpret_cast<const uint8_t*>(&v), sizeof(T));
+    }
+
+    /**
+     * @brief Get the number of bytes appended so far.
+     */
+    uint16_t size() const { return m_len; }
+
+  private:
+    friend class NimBLEServer;
+    NimBLEReadResponse(os_mbuf* om, uint16_t maxLen) : m_om{om}, m_maxLen{maxLen} {}
+
+    os_mbuf* m_om;
+    uint16_t m_maxLen;
+    uint16_t m_len{0};
+    int      m_rc{0};
+}; // NimBLEReadResponse
+
 class NimBLELocalValueAttribute : public NimBLELocalAttribute, public NimBLEValueAttribute {
   public:
+    /**
+     * @brief A function that produces the attribute value when it is read by a peer.
+     * @details Called on the host task for each read request, after the onRead callback.
+     */
+    using ValueProvider = std::function<void(NimBLEConnInfo& connInfo, NimBLEReadResponse& rsp)>;
+
     /**
      * @brief Get the properties of the attribute.
      */
@@ -88,6 +158,24 @@ class NimBLELocalValueAttribute : public NimBLELocalAttribute, public NimBLEValu
         m_value.setValue<T>(val);
     }
 
+    /**
+     * @brief Template to set the value by encoding fields with a NimBLESchema.
+     * @tparam Schema The NimBLESchema type describing the payload layout.
+     * @param [in] values The field values, in schema order.
+     */
+    template <typename Schema, typename... Args>
+    void setFields(const Args&... values) {
+        m_value.setFields<Schema>(values...);
+    }
+
+    /**
+     * @brief Set a function to provide the value on demand when the attribute is read.
+     * @param [in] provider The provider function, or nullptr to read from the stored value again.
+     * @details The provider appends the value directly to the response, so fast changing data does not need to be
+     * copied into the attribute with setValue() in case a peer reads it. The stored value is not updated.
+     */
+    void setValueProvider(ValueProvider provider) { m_valueProvider = std::move(provider); }
+
   protected:
     friend class NimBLEServer;
 
@@ -131,13 +219,21 @@ class NimBLELocalValueAttribute : public NimBLELocalAttribute, public NimBLEValu
      */
     const NimBLEAttValue& getAttVal() const { return m_value; }
 
+    /**
+     * @brief Get the value of the attribute as seen by a connection.
+     * @param [in] connHandle The connection handle of the peer.
+     * @return The value to read or write for the peer, by default the shared value of the attribute.
+     */
+    virtual const NimBLEAttValue& getPeerAttVal(uint16_t connHandle) const { return m_value; }
+
     /**
      * @brief Set the properties of the attribute.
      * @param [in] properties The properties of the attribute.
      */
     void setProperties(uint16_t properties) { m_properties = properties; }
 
-    uint16_t m_properties{0};
+    uint16_t      m_properties{0};
+    ValueProvider m_valueProvider{nullptr};
 };
 
 #endif // CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_PERIPHERAL)
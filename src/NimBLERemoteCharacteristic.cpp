@@ -18,13 +18,23 @@
 #include "NimBLERemoteCharacteristic.h"
 #if CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_CENTRAL)
 
+# ifdef USING_NIMBLE_ARDUINO_HEADERS
+#  include "nimble/porting/nimble/include/os/os_mbuf.h"
+#  include "nimble/porting/nimble/include/nimble/nimble_port.h"
+# else
+#  include "os/os_mbuf.h"
+#  include "nimble/nimble_port.h"
+# endif
+
 # include "NimBLERemoteDescriptor.h"
 # include "NimBLERemoteService.h"
 # include "NimBLEClient.h"
+# include "NimBLEDevice.h"
 # include "NimBLEUtils.h"
 # include "NimBLELog.h"
 
 # include <climits>
+# include <new>
 
 struct NimBLEDescriptorFilter {
     NimBLERemoteDescriptor* dsc;
@@ -32,8 +42,68 @@ struct NimBLEDescriptorFilter {
     void*                   taskData;
 };
 
+# ifndef MYNEWT_VAL_NIMBLE_CPP_BULK_WRITE_BURST
+#  define MYNEWT_VAL_NIMBLE_CPP_BULK_WRITE_BURST (8)
+# endif
+
+# ifndef MYNEWT_VAL_NIMBLE_CPP_BULK_WRITE_MBUF_RESERVE
+#  define MYNEWT_VAL_NIMBLE_CPP_BULK_WRITE_MBUF_RESERVE (4)
+# endif
+
+# ifndef MYNEWT_VAL_NIMBLE_CPP_BULK_WRITE_RETRY_MS
+#  define MYNEWT_VAL_NIMBLE_CPP_BULK_WRITE_RETRY_MS (1)
+# endif
+
 static const char* LOG_TAG = "NimBLERemoteCharacteristic";
 
+/**
+ * @brief State of a bulk write, paced from the NimBLE host task.
+ * @details The events carry the write rather than the characteristic, a write abandoned by the
+ * destruction of the characteristic has m_pChr cleared and is deleted by m_deleteEvent on the host task.
+ */
+struct NimBLERemoteCharacteristic::BulkWrite {
+    BulkWrite(const NimBLERemoteCharacteristic* pChr, const uint8_t* data, size_t length)
+        : m_pChr{pChr}, m_data{data}, m_length{length}, m_start{ble_npl_time_get()} {
+        m_stats.totalBytes = length;
+        ble_npl_callout_init(&m_retryTimer,
+                             nimble_port_get_dflt_eventq(),
+                             NimBLERemoteCharacteristic::bulkWriteEventCb,
+                             this);
+        ble_npl_event_init(&m_drainEvent, NimBLERemoteCharacteristic::bulkWriteEventCb, this);
+        ble_npl_event_init(&m_deleteEvent, BulkWrite::deleteEventCb, this);
+    }
+
+    ~BulkWrite() {
+        ble_npl_callout_stop(&m_retryTimer);
+        ble_npl_callout_deinit(&m_retryTimer);
+        ble_npl_eventq_remove(nimble_port_get_dflt_eventq(), &m_drainEvent);
+        ble_npl_event_deinit(&m_drainEvent);
+        ble_npl_eventq_remove(nimble_port_get_dflt_eventq(), &m_deleteEvent);
+        ble_npl_event_deinit(&m_deleteEvent);
+    }
+
+    /** @brief Event callback that deletes an abandoned write. */
+    static void deleteEventCb(struct ble_npl_event* ev) { delete static_cast<BulkWrite*>(ble_npl_event_get_arg(ev)); }
+
+    /** @brief Update the elapsed time and throughput of the statistics. */
+    const BulkWriteStats& updateStats() {
+        m_stats.elapsedMs   = ble_npl_time_ticks_to_ms32(ble_npl_time_get() - m_start);
+        m_stats.bytesPerSec = m_stats.elapsedMs ? (uint64_t)m_stats.bytesSent * 1000 / m_stats.elapsedMs : 0;
+        return m_stats;
+    }
+
+    const NimBLERemoteCharacteristic* m_pChr;
+    const uint8_t*                    m_data;
+    size_t                            m_length;
+    ble_npl_time_t                    m_start;
+    BulkWriteStats                    m_stats{};
+    bulk_write_callback               m_callback{nullptr};
+    bulk_progress_callback            m_progress{nullptr};
+    ble_npl_event                     m_drainEvent{};
+    ble_npl_event                     m_deleteEvent{};
+    ble_npl_callout                   m_retryTimer{};
+}; // BulkWrite
+
 /**
  * @brief Constructor.
  * @param [in] svc A pointer to the service this characteristic belongs to.
@@ -56,6 +126,20 @@ NimBLERemoteCharacteristic::NimBLERemoteCharacteristic(const NimBLERemoteService
  *@brief Destructor.
  */
 NimBLERemoteCharacteristic::~NimBLERemoteCharacteristic() {
+    // An active bulk write is abandoned without its callback and released on the host task,
+    // after any of its pending events has run.
+    BulkWrite* pBulk = m_pBulkWrite;
+    if (pBulk != nullptr) {
+        m_pBulkWrite  = nullptr;
+        pBulk->m_pChr = nullptr;
+        if (NimBLEDevice::isInitialized()) {
+            ble_npl_eventq_put(nimble_port_get_dflt_eventq(), &pBulk->m_deleteEvent);
+        } else {
+            delete pBulk;
+        }
+    }
+
+    getClient()->removeNotifyTarget(getHandle());
     deleteDescriptors();
 } // ~NimBLERemoteCharacteristic
 
@@ -94,21 +178,7 @@ int NimBLERemoteCharacteristic::descriptorDiscCB(
 bool NimBLERemoteCharacteristic::retrieveDescriptors(NimBLEDescriptorFilter* pFilter) const {
     NIMBLE_LOGD(LOG_TAG, ">> retrieveDescriptors() for characteristic: %s", getUUID().toString().c_str());
 
-    const auto pSvc      = getRemoteService();
-    uint16_t   endHandle = pSvc->getEndHandle();
-
-    // Find the handle of the next characteristic to limit the descriptor search range.
-    const auto& chars = pSvc->getCharacteristics(false);
-    for (auto it = chars.begin(); it != chars.end(); ++it) {
-        if ((*it)->getHandle() == this->getHandle()) {
-            auto next_it = std::next(it);
-            if (next_it != chars.end()) {
-                endHandle = (*next_it)->getHandle() - 1;
-                NIMBLE_LOGD(LOG_TAG, "Search range limited to handle 0x%04X", endHandle);
-            }
-            break;
-        }
-    }
+    uint16_t endHandle = getDescriptorEndHandle();
 
     // If this is the last handle then there are no descriptors
     if (getHandle() == endHandle) {
@@ -148,6 +218,30 @@ bool NimBLERemoteCharacteristic::retrieveDescriptors(NimBLEDescriptorFilter* pFi
     return true;
 } // retrieveDescriptors
 
+/**
+ * @brief Get the last handle that can hold a descriptor of this characteristic.
+ * @return The handle before the next characteristic or the end handle of the service.
+ */
+uint16_t NimBLERemoteCharacteristic::getDescriptorEndHandle() const {
+    const auto pSvc      = getRemoteService();
+    uint16_t   endHandle = pSvc->getEndHandle();
+
+    // Find the handle of the next characteristic to limit the descriptor search range.
+    const auto& chars = pSvc->getCharacteristics(false);
+    for (auto it = chars.begin(); it != chars.end(); ++it) {
+        if ((*it)->getHandle() == this->getHandle()) {
+            auto next_it = std::next(it);
+            if (next_it != chars.end()) {
+                endHandle = (*next_it)->getHandle() - 1;
+                NIMBLE_LOGD(LOG_TAG, "Search range limited to handle 0x%04X", endHandle);
+            }
+            break;
+        }
+    }
+
+    return endHandle;
+} // getDescriptorEndHandle
+
 /**
  * @brief Get the descriptor instance with the given UUID that belongs to this characteristic.
  * @param [in] uuid The UUID of the descriptor to find.
@@ -261,18 +355,367 @@ bool NimBLERemoteCharacteristic::setNotify(uint16_t val, notify_callback notifyC
  * @return false if writing to the descriptor failed.
  */
 bool NimBLERemoteCharacteristic::subscribe(bool notifications, notify_callback notifyCallback, bool response) const {
+    m_notifyFn = nullptr;
     return setNotify(notifications ? 0x01 : 0x02, notifyCallback, response);
 } // subscribe
 
+/**
+ * @brief Subscribe for notifications or indications with a function pointer callback.
+ * @param [in] notifications If true, subscribe for notifications, false subscribe for indications.
+ * @param [in] notifyFn The function to be invoked for a notification, nullptr for none.
+ * @param [in] pContext A pointer passed to notifyFn with each notification.
+ * @param [in] response If true, require a write response from the descriptor write operation.
+ * @return false if writing to the descriptor failed.
+ * @details This avoids the std::function invocation for each notification, it replaces any
+ * notify_callback set on this characteristic.
+ */
+bool NimBLERemoteCharacteristic::subscribe(bool      notifications,
+                                           notify_fn notifyFn,
+                                           void*     pContext,
+                                           bool      response) const {
+    m_notifyFn  = notifyFn;
+    m_notifyCtx = pContext;
+    return setNotify(notifications ? 0x01 : 0x02, nullptr, response);
+} // subscribe
+
 /**
  * @brief Unsubscribe for notifications or indications.
  * @param [in] response bool if true, require a write response from the descriptor write operation.
  * @return false if writing to the descriptor failed.
  */
 bool NimBLERemoteCharacteristic::unsubscribe(bool response) const {
+    m_notifyFn = nullptr;
     return setNotify(0x00, nullptr, response);
 } // unsubscribe
 
+/**
+ * @brief State of an asynchronous subscription waiting for the descriptor discovery.
+ */
+struct NimBLESubscribeOp {
+    const NimBLERemoteCharacteristic*          pChr;
+    uint16_t                                   val;
+    NimBLERemoteValueAttribute::write_callback callback;
+    ble_npl_event                              doneEvent{};
+
+    /** @brief Event callback that reports a subscription completed without a descriptor write. */
+    static void doneEventCb(struct ble_npl_event* ev) {
+        auto pOp = static_cast<NimBLESubscribeOp*>(ble_npl_event_get_arg(ev));
+        ble_npl_event_deinit(&pOp->doneEvent);
+        pOp->callback(const_cast<NimBLERemoteCharacteristic*>(pOp->pChr), 0);
+        delete pOp;
+    }
+};
+
+/**
+ * @brief Subscribe for notifications or indications without blocking.
+ * @param [in] notifications If true, subscribe for notifications, false subscribe for indications.
+ * @param [in] notifyCallback A callback to be invoked for a notification.
+ * @param [in] callback The callback invoked from the host task with this characteristic when the
+ * Client Characteristic Configuration descriptor has been written.
+ * @return True if the subscription was started, the callback is only invoked in this case.
+ * @details If the descriptors have not been retrieved they are discovered first, also without blocking.
+ * If the characteristic has no Client Characteristic Configuration descriptor only the notification callback
+ * is set and the callback is called from the host task with a result of 0.
+ */
+bool NimBLERemoteCharacteristic::subscribeAsync(bool                  notifications,
+                                                const notify_callback notifyCallback,
+                                                write_callback        callback) const {
+    m_notifyFn = nullptr;
+    return setNotifyAsync(notifications ? 0x01 : 0x02, notifyCallback, std::move(callback));
+} // subscribeAsync
+
+/**
+ * @brief Unsubscribe for notifications or indications without blocking.
+ * @param [in] callback The callback invoked from the host task when the descriptor has been written.
+ * @return True if the unsubscribe was started, the callback is only invoked in this case.
+ * @details If the characteristic has no Client Characteristic Configuration descriptor the callback is called
+ * from the host task with a result of 0.
+ */
+bool NimBLERemoteCharacteristic::unsubscribeAsync(write_callback callback) const {
+    m_notifyFn = nullptr;
+    return setNotifyAsync(0x00, nullptr, std::move(callback));
+} // unsubscribeAsync
+
+/**
+ * @brief Write the Client Characteristic Configuration descriptor without blocking.
+ * @param [in] val 0x00 to unsubscribe, 0x01 for notifications, 0x02 for indications.
+ * @param [in] notifyCallback A callback to be invoked for a notification.
+ * @param [in] callback The completion callback.
+ * @return True if the operation was started.
+ */
+bool NimBLERemoteCharacteristic::setNotifyAsync(uint16_t        val,
+                                                notify_callback notifyCallback,
+                                                write_callback  callback) const {
+    NIMBLE_LOGD(LOG_TAG, ">> setNotifyAsync()");
+
+    m_notifyCallback = notifyCallback;
+    int rc           = 0;
+    for (const auto& dsc : m_vDescriptors) {
+        if (dsc->getUUID() == NimBLEUUID((uint16_t)0x2902)) {
+            rc = writeCccdAsync(dsc, val, std::move(callback));
+            goto Done;
+        }
+    }
+
+    {
+        uint16_t endHandle = getDescriptorEndHandle();
+        if (endHandle == getHandle()) {
+            NIMBLE_LOGW(LOG_TAG, "<< setNotifyAsync(): Callback set, CCCD not found");
+            if (callback != nullptr) {
+                auto pDone = new (std::nothrow) NimBLESubscribeOp{this, val, std::move(callback)};
+                if (pDone == nullptr) {
+                    rc = BLE_HS_ENOMEM;
+                    goto Done;
+                }
+
+                ble_npl_event_init(&pDone->doneEvent, NimBLESubscribeOp::doneEventCb, pDone);
+                ble_npl_eventq_put(nimble_port_get_dflt_eventq(), &pDone->doneEvent);
+            }
+            return true;
+        }
+
+        auto pOp = new (std::nothrow) NimBLESubscribeOp{this, val, std::move(callback)};
+        if (pOp == nullptr) {
+            rc = BLE_HS_ENOMEM;
+            goto Done;
+        }
+
+        rc = ble_gattc_disc_all_dscs(getClient()->getConnHandle(),
+                                     getHandle(),
+                                     endHandle,
+                                     NimBLERemoteCharacteristic::descriptorDiscAsyncCB,
+                                     pOp);
+        if (rc != 0) {
+            delete pOp;
+        }
+    }
+
+Done:
+    if (rc != 0) {
+        NIMBLE_LOGE(LOG_TAG, "<< setNotifyAsync(): failed rc=%d %s", rc, NimBLEUtils::returnCodeToString(rc));
+    } else {
+        NIMBLE_LOGD(LOG_TAG, "<< setNotifyAsync()");
+    }
+
+    return rc == 0;
+} // setNotifyAsync
+
+/**
+ * @brief Start the asynchronous write of the Client Characteristic Configuration descriptor.
+ * @return 0 if the write was started, the callback receives this characteristic, otherwise the error code.
+ */
+int NimBLERemoteCharacteristic::writeCccdAsync(NimBLERemoteDescriptor* pCccd,
+                                               uint16_t                val,
+                                               write_callback          callback) const {
+    const auto pChr = const_cast<NimBLERemoteCharacteristic*>(this);
+    auto       onDone = [pChr, callback](NimBLERemoteValueAttribute*, int rc) {
+        if (callback != nullptr) {
+            callback(pChr, rc);
+        }
+    };
+
+    return pCccd->writeAsync(reinterpret_cast<uint8_t*>(&val), 2, onDone);
+} // writeCccdAsync
+
+/**
+ * @brief Descriptor discovery callback of setNotifyAsync, writes the CCCD when the discovery is done.
+ */
+int NimBLERemoteCharacteristic::descriptorDiscAsyncCB(
+    uint16_t connHandle, const ble_gatt_error* error, uint16_t chrHandle, const ble_gatt_dsc* dsc, void* arg) {
+    auto       pOp  = static_cast<NimBLESubscribeOp*>(arg);
+    const auto pChr = pOp->pChr;
+    int        rc   = error->status;
+
+    if (rc == 0) {
+        if (pChr->getHandle() == chrHandle) {
+            for (const auto& it : pChr->m_vDescriptors) {
+                if (it->getHandle() == dsc->handle) {
+                    return 0;
+                }
+            }
+
+            pChr->m_vDescriptors.push_back(new NimBLERemoteDescriptor(pChr, dsc));
+        }
+        return 0;
+    }
+
+    if (rc == BLE_HS_EDONE) {
+        rc = 0;
+        for (const auto& it : pChr->m_vDescriptors) {
+            if (it->getUUID() == NimBLEUUID((uint16_t)0x2902)) {
+                rc = pChr->writeCccdAsync(it, pOp->val, pOp->callback);
+                if (rc == 0) {
+                    delete pOp;
+                    return 0;
+                }
+                break;
+            }
+        }
+
+        if (rc == 0) {
+            NIMBLE_LOGW(LOG_TAG, "setNotifyAsync(): Callback set, CCCD not found");
+        }
+    }
+
+    if (pOp->callback != nullptr) {
+        pOp->callback(const_cast<NimBLERemoteCharacteristic*>(pChr), rc);
+    }
+
+    delete pOp;
+    return 0;
+} // descriptorDiscAsyncCB
+
+/**
+ * @brief Write a buffer larger than the MTU with write commands (write without response).
+ * @param [in] data The data to write, must remain valid until the completion callback is called.
+ * @param [in] length The number of bytes to write.
+ * @param [in] callback The function called from the host task when all data has been accepted by the stack
+ * or the write failed, with the result code and the final statistics.
+ * @param [in] progress Optional function called from the host task each time the write pauses, with
+ * the bytes sent so far and the throughput.
+ * @return True if the write was started, the callback is only invoked in this case.
+ * @details The buffer is split in chunks of MTU - 3 bytes that are sent from the host task in bursts
+ * of NIMBLE_CPP_BULK_WRITE_BURST commands. Before each command the free msys blocks are checked
+ * and the write pauses while no more than NIMBLE_CPP_BULK_WRITE_MBUF_RESERVE are left, resuming once
+ * the controller has released buffers, so the link stays saturated without busy waiting or failing
+ * on a full buffer pool, while the pool stays low the write is retried every NIMBLE_CPP_BULK_WRITE_RETRY_MS.
+ * Only one bulk write can be active on a characteristic.\n
+ * If the characteristic is deleted while the write is active, for example when the services of the client
+ * are deleted, the write is abandoned and the callback is not invoked.
+ */
+bool NimBLERemoteCharacteristic::writeBulk(const uint8_t*         data,
+                                           size_t                 length,
+                                           bulk_write_callback    callback,
+                                           bulk_progress_callback progress) const {
+    if (m_pBulkWrite != nullptr) {
+        NIMBLE_LOGE(LOG_TAG, "writeBulk: a bulk write is already active");
+        return false;
+    }
+
+    if (!getClient()->isConnected()) {
+        NIMBLE_LOGE(LOG_TAG, "writeBulk: not connected");
+        return false;
+    }
+
+    auto pBulk = new (std::nothrow) BulkWrite(this, data, length);
+    if (pBulk == nullptr) {
+        NIMBLE_LOGE(LOG_TAG, "writeBulk: out of memory");
+        return false;
+    }
+
+    pBulk->m_callback = std::move(callback);
+    pBulk->m_progress = std::move(progress);
+    m_pBulkWrite      = pBulk;
+    ble_npl_eventq_put(nimble_port_get_dflt_eventq(), &pBulk->m_drainEvent);
+    return true;
+} // writeBulk
+
+/**
+ * @brief Check if a bulk write is in progress on this characteristic.
+ * @return True if writeBulk was started and has not completed.
+ */
+bool NimBLERemoteCharacteristic::isBulkWriteActive() const {
+    return m_pBulkWrite != nullptr;
+} // isBulkWriteActive
+
+/**
+ * @brief Event callback to continue a bulk write.
+ * @param[in] ev Pointer to the event that triggered the callback.
+ */
+void NimBLERemoteCharacteristic::bulkWriteEventCb(struct ble_npl_event* ev) {
+    auto* pBulk = static_cast<BulkWrite*>(ble_npl_event_get_arg(ev));
+    if (pBulk->m_pChr) {
+        pBulk->m_pChr->drainBulkWrite();
+    }
+} // bulkWriteEventCb
+
+/**
+ * @brief Send the next burst of a bulk write.
+ * @details Called only from the NimBLE host task. When the buffer pool runs low a short retry is
+ * scheduled instead of waiting, after a full burst the write yields to the other host events,
+ * which include the completed packet events that return the buffers.
+ */
+void NimBLERemoteCharacteristic::drainBulkWrite() const {
+    BulkWrite* pBulk = m_pBulkWrite;
+    if (!pBulk) {
+        return;
+    }
+
+    const uint16_t mtu = getClient()->getMTU();
+    if (mtu < BLE_ATT_MTU_DFLT) {
+        finishBulkWrite(BLE_HS_ENOTCONN);
+        return;
+    }
+
+    auto& stats = pBulk->m_stats;
+    for (uint8_t burst = 0; stats.bytesSent < pBulk->m_length; burst++) {
+        if (burst == MYNEWT_VAL(NIMBLE_CPP_BULK_WRITE_BURST)) {
+            ble_npl_eventq_put(nimble_port_get_dflt_eventq(), &pBulk->m_drainEvent);
+            break;
+        }
+
+        int rc = BLE_HS_ENOMEM;
+        if (os_msys_num_free() > MYNEWT_VAL(NIMBLE_CPP_BULK_WRITE_MBUF_RESERVE)) {
+            uint16_t len = std::min<size_t>(mtu - 3, pBulk->m_length - stats.bytesSent);
+            rc           = ble_gattc_write_no_rsp_flat(getClient()->getConnHandle(),
+                                             getHandle(),
+                                             pBulk->m_data + stats.bytesSent,
+                                             len);
+            if (rc == 0) {
+                stats.bytesSent += len;
+                stats.chunks++;
+                continue;
+            }
+        }
+
+        if (rc == BLE_HS_ENOMEM) {
+            ble_npl_time_t wait = ble_npl_time_ms_to_ticks32(MYNEWT_VAL(NIMBLE_CPP_BULK_WRITE_RETRY_MS));
+            ble_npl_callout_reset(&pBulk->m_retryTimer, wait ? wait : 1);
+            stats.bufferWaits++;
+            break;
+        }
+
+        NIMBLE_LOGE(LOG_TAG, "writeBulk: rc=%d %s", rc, NimBLEUtils::returnCodeToString(rc));
+        finishBulkWrite(rc);
+        return;
+    }
+
+    if (stats.bytesSent == pBulk->m_length) {
+        finishBulkWrite(0);
+        return;
+    }
+
+    if (pBulk->m_progress) {
+        pBulk->m_progress(this, pBulk->updateStats());
+    }
+} // drainBulkWrite
+
+/**
+ * @brief Complete the active bulk write and invoke its callback.
+ * @param [in] rc The result code of the write.
+ */
+void NimBLERemoteCharacteristic::finishBulkWrite(int rc) const {
+    BulkWrite* pBulk = m_pBulkWrite;
+    m_pBulkWrite     = nullptr;
+
+    const BulkWriteStats stats    = pBulk->updateStats();
+    bulk_write_callback  callback = std::move(pBulk->m_callback);
+    delete pBulk;
+
+    NIMBLE_LOGD(LOG_TAG,
+                "Bulk write done rc=%d, %zu bytes in %" PRIu32 " chunks, %" PRIu32 " ms, %" PRIu32 " B/s, %" PRIu32
+                " buffer waits",
+                rc,
+                stats.bytesSent,
+                stats.chunks,
+                stats.elapsedMs,
+                stats.bytesPerSec,
+                stats.bufferWaits);
+    if (callback) {
+        callback(this, rc, stats);
+    }
+} // finishBulkWrite
+
 /**
  * @brief Delete the descriptors in the descriptor vector.
  * @details We maintain a vector called m_vDescriptors that contains pointers to NimBLERemoteDescriptors
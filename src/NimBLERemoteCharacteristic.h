@@ -51,8 +51,37 @@ class NimBLERemoteCharacteristic : public NimBLERemoteValueAttribute {
 
     typedef std::function<void(NimBLERemoteCharacteristic* pBLERemoteCharacteristic, uint8_t* pData, size_t length, bool isNotify)> notify_callback;
 
+    /**
+     * @brief Lightweight notification callback, called from the host task with the context given to subscribe.
+     */
+    typedef void (*notify_fn)(NimBLERemoteCharacteristic* pChr, const uint8_t* pData, size_t length, bool isNotify, void* pContext);
+
     bool subscribe(bool notifications = true, const notify_callback notifyCallback = nullptr, bool response = true) const;
+    bool subscribe(bool notifications, notify_fn notifyFn, void* pContext, bool response = true) const;
     bool unsubscribe(bool response = true) const;
+    bool subscribeAsync(bool notifications, const notify_callback notifyCallback, write_callback callback) const;
+    bool unsubscribeAsync(write_callback callback) const;
+
+    /**
+     * @brief Progress and throughput of a bulk write.
+     */
+    struct BulkWriteStats {
+        size_t   bytesSent{0};   // Bytes accepted by the stack.
+        size_t   totalBytes{0};  // Length of the buffer being written.
+        uint32_t chunks{0};      // Write commands sent.
+        uint32_t bufferWaits{0}; // Times the write paused until mbufs were released.
+        uint32_t elapsedMs{0};   // Time since the write was started.
+        uint32_t bytesPerSec{0}; // Average throughput since the write was started.
+    };
+
+    typedef std::function<void(const NimBLERemoteCharacteristic* pChr, const BulkWriteStats& stats)> bulk_progress_callback;
+    typedef std::function<void(const NimBLERemoteCharacteristic* pChr, int rc, const BulkWriteStats& stats)> bulk_write_callback;
+
+    bool writeBulk(const uint8_t*         data,
+                   size_t                 length,
+                   bulk_write_callback    callback,
+                   bulk_progress_callback progress = nullptr) const;
+    bool isBulkWriteActive() const;
 
     std::vector<NimBLERemoteDescriptor*>::iterator begin() const;
     std::vector<NimBLERemoteDescriptor*>::iterator end() const;
@@ -62,20 +91,34 @@ class NimBLERemoteCharacteristic : public NimBLERemoteValueAttribute {
   private:
     friend class NimBLEClient;
     friend class NimBLERemoteService;
+    friend class NimBLECentralManager;
 
     NimBLERemoteCharacteristic(const NimBLERemoteService* pRemoteService, const ble_gatt_chr* chr);
     ~NimBLERemoteCharacteristic();
 
-    bool setNotify(uint16_t val, notify_callback notifyCallback = nullptr, bool response = true) const;
-    bool retrieveDescriptors(NimBLEDescriptorFilter* pFilter = nullptr) const;
+    bool     setNotify(uint16_t val, notify_callback notifyCallback = nullptr, bool response = true) const;
+    bool     setNotifyAsync(uint16_t val, notify_callback notifyCallback, write_callback callback) const;
+    int      writeCccdAsync(NimBLERemoteDescriptor* pCccd, uint16_t val, write_callback callback) const;
+    bool     retrieveDescriptors(NimBLEDescriptorFilter* pFilter = nullptr) const;
+    uint16_t getDescriptorEndHandle() const;
+
+    struct BulkWrite;
+    static void bulkWriteEventCb(struct ble_npl_event* ev);
+    void        drainBulkWrite() const;
+    void        finishBulkWrite(int rc) const;
 
     static int descriptorDiscCB(
         uint16_t connHandle, const ble_gatt_error* error, uint16_t chrHandle, const ble_gatt_dsc* dsc, void* arg);
+    static int descriptorDiscAsyncCB(
+        uint16_t connHandle, const ble_gatt_error* error, uint16_t chrHandle, const ble_gatt_dsc* dsc, void* arg);
 
     const NimBLERemoteService*                   m_pRemoteService{nullptr};
     uint8_t                                      m_properties{0};
     mutable notify_callback                      m_notifyCallback{nullptr};
+    mutable notify_fn                            m_notifyFn{nullptr};
+    mutable void*                                m_notifyCtx{nullptr};
     mutable std::vector<NimBLERemoteDescriptor*> m_vDescriptors{};
+    mutable BulkWrite*                           m_pBulkWrite{nullptr};
 
 }; // NimBLERemoteCharacteristic
 
@@ -37,6 +37,7 @@ class NimBLERemoteDescriptor : public NimBLERemoteValueAttribute {
 
   private:
     friend class NimBLERemoteCharacteristic;
+    friend class NimBLEClient;
 
     NimBLERemoteDescriptor(const NimBLERemoteCharacteristic* pRemoteCharacteristic, const ble_gatt_dsc* dsc);
     ~NimBLERemoteDescriptor() = default;
@@ -23,6 +23,7 @@
 # include "NimBLELog.h"
 
 # include <climits>
+# include <new>
 
 static const char* LOG_TAG = "NimBLERemoteValueAttribute";
 
@@ -120,18 +121,45 @@ int NimBLERemoteValueAttribute::onWriteCB(uint16_t conn_handle, const ble_gatt_e
  * @brief Read the value of the remote characteristic.
  * @param [in] timestamp A pointer to a time_t struct to store the time the value was read.
  * @return The value of the remote characteristic.
+ * @details The read starts with a single Read Request and only continues with Read Blob Requests when the
+ * response fills the MTU. If the peer reports that the attribute is not long-readable the value received is
+ * complete and later reads of this attribute use a single Read Request.
  */
 NimBLEAttValue NimBLERemoteValueAttribute::readValue(time_t* timestamp) {
+    NimBLEAttValue value{};
+    performRead(value, timestamp);
+    return value;
+} // readValue
+
+/**
+ * @brief Read the value of the remote attribute and report the result code.
+ * @param [out] value The value read, may hold a partial value when the read fails.
+ * @param [in] timestamp A pointer to a time_t struct to store the time the value was read.
+ * @return 0 on success or the error code of the read.
+ */
+int NimBLERemoteValueAttribute::performRead(NimBLEAttValue& value, time_t* timestamp) {
     NIMBLE_LOGD(LOG_TAG, ">> readValue()");
 
-    NimBLEAttValue      value{};
     const NimBLEClient* pClient    = getClient();
     int                 rc         = 0;
     int                 retryCount = 1;
     NimBLETaskData      taskData(const_cast<NimBLERemoteValueAttribute*>(this), 0, &value);
 
     do {
-        rc = ble_gattc_read_long(pClient->getConnHandle(), getHandle(), 0, NimBLERemoteValueAttribute::onReadCB, &taskData);
+        if (m_shortRead) {
+            rc = ble_gattc_read(pClient->getConnHandle(),
+                                getHandle(),
+                                NimBLERemoteValueAttribute::onShortReadCB,
+                                &taskData);
+        } else {
+            // Sends a Read Request first and Read Blob Requests only while the responses fill the MTU.
+            rc = ble_gattc_read_long(pClient->getConnHandle(),
+                                     getHandle(),
+                                     0,
+                                     NimBLERemoteValueAttribute::onReadCB,
+                                     &taskData);
+        }
+
         if (rc != 0) {
             goto Done;
         }
@@ -143,14 +171,18 @@ NimBLEAttValue NimBLERemoteValueAttribute::readValue(time_t* timestamp) {
             case BLE_HS_EDONE:
                 rc = 0;
                 break;
-            // Characteristic is not long-readable, return with what we have.
+            // Characteristic is not long-readable, the first response holds the value.
             case BLE_HS_ATT_ERR(BLE_ATT_ERR_ATTR_NOT_LONG):
                 NIMBLE_LOGI(LOG_TAG, "Attribute not long");
-                rc = ble_gattc_read(pClient->getConnHandle(), getHandle(), NimBLERemoteValueAttribute::onReadCB, &taskData);
-                if (rc != 0) {
+                m_shortRead = true;
+                rc          = 0;
+                break;
+            // The value length is a multiple of the response size.
+            case BLE_HS_ATT_ERR(BLE_ATT_ERR_INVALID_OFFSET):
+                if (value.size() == 0) {
                     goto Done;
                 }
-                retryCount++;
+                rc = 0;
                 break;
             case BLE_HS_ATT_ERR(BLE_ATT_ERR_INSUFFICIENT_AUTHEN):
             case BLE_HS_ATT_ERR(BLE_ATT_ERR_INSUFFICIENT_AUTHOR):
@@ -175,8 +207,8 @@ Done:
         NIMBLE_LOGD(LOG_TAG, "<< readValue");
     }
 
-    return value;
-} // readValue
+    return rc;
+} // performRead
 
 /**
  * @brief Callback for characteristic read operation.
@@ -217,4 +249,217 @@ int NimBLERemoteValueAttribute::onReadCB(uint16_t conn_handle, const ble_gatt_er
     return rc;
 } // onReadCB
 
+/**
+ * @brief State of an asynchronous read or write, owned by the stack until the completion callback.
+ */
+struct NimBLERemoteValueAttribute::AsyncOp {
+    AsyncOp(NimBLERemoteValueAttribute* pAtt, bool shortRead) : pAtt{pAtt}, shortRead{shortRead} {}
+
+    NimBLERemoteValueAttribute* pAtt;
+    bool                        shortRead;
+    NimBLEAttValue              value{};
+    read_callback               readCb{nullptr};
+    write_callback              writeCb{nullptr};
+};
+
+/**
+ * @brief Read the value of the remote attribute without blocking.
+ * @param [in] callback The callback invoked from the host task when the read completes or fails.
+ * @return True if the read was started, the callback is only invoked in this case.
+ * @details Uses the same read strategy as readValue(). Errors are reported to the callback without
+ * securing the connection and retrying. The attribute must not be deleted while the read is pending.
+ */
+bool NimBLERemoteValueAttribute::readValueAsync(read_callback callback) {
+    const NimBLEClient* pClient = getClient();
+    auto                pOp     = new (std::nothrow) AsyncOp{this, m_shortRead};
+    if (pOp == nullptr) {
+        NIMBLE_LOGE(LOG_TAG, "readValueAsync: out of memory");
+        return false;
+    }
+
+    pOp->readCb = std::move(callback);
+
+    int rc = 0;
+    if (pOp->shortRead) {
+        rc = ble_gattc_read(pClient->getConnHandle(), getHandle(), NimBLERemoteValueAttribute::onAsyncReadCB, pOp);
+    } else {
+        rc = ble_gattc_read_long(pClient->getConnHandle(),
+                                 getHandle(),
+                                 0,
+                                 NimBLERemoteValueAttribute::onAsyncReadCB,
+                                 pOp);
+    }
+
+    if (rc != 0) {
+        NIMBLE_LOGE(LOG_TAG, "readValueAsync failed rc=%d, %s", rc, NimBLEUtils::returnCodeToString(rc));
+        delete pOp;
+        return false;
+    }
+
+    return true;
+} // readValueAsync
+
+/**
+ * @brief Write a new value to the remote attribute with a response without blocking.
+ * @param [in] data A pointer to a data buffer, the data is copied before returning.
+ * @param [in] length The length of the data in the data buffer.
+ * @param [in] callback The callback invoked from the host task when the write completes or fails.
+ * @return True if the write was started, the callback is only invoked in this case.
+ * @details Values longer than the MTU allows are sent with a long write.
+ * Writes without response do not block, use writeValue() for those.
+ */
+bool NimBLERemoteValueAttribute::writeValueAsync(const uint8_t* data, size_t length, write_callback callback) const {
+    int rc = writeAsync(data, length, std::move(callback));
+    if (rc != 0) {
+        NIMBLE_LOGE(LOG_TAG, "writeValueAsync failed rc=%d, %s", rc, NimBLEUtils::returnCodeToString(rc));
+    }
+
+    return rc == 0;
+} // writeValueAsync
+
+/**
+ * @brief Start an asynchronous write with response.
+ * @return 0 if the write was started, otherwise the error code and the callback is not invoked.
+ */
+int NimBLERemoteValueAttribute::writeAsync(const uint8_t* data, size_t length, write_callback callback) const {
+    const NimBLEClient* pClient = getClient();
+    auto                pOp     = new (std::nothrow) AsyncOp{const_cast<NimBLERemoteValueAttribute*>(this), false};
+    if (pOp == nullptr) {
+        return BLE_HS_ENOMEM;
+    }
+
+    pOp->writeCb = std::move(callback);
+
+    int rc = 0;
+    if (length > static_cast<size_t>(pClient->getMTU() - 3)) {
+        os_mbuf* om = ble_hs_mbuf_from_flat(data, length);
+
+        rc = ble_gattc_write_long(pClient->getConnHandle(),
+                                  getHandle(),
+                                  0,
+                                  om,
+                                  NimBLERemoteValueAttribute::onAsyncWriteCB,
+                                  pOp);
+    } else {
+        rc = ble_gattc_write_flat(pClient->getConnHandle(),
+                                  getHandle(),
+                                  data,
+                                  length,
+                                  NimBLERemoteValueAttribute::onAsyncWriteCB,
+                                  pOp);
+    }
+
+    if (rc != 0) {
+        delete pOp;
+    }
+
+    return rc;
+} // writeAsync
+
+/**
+ * @brief Callback for an asynchronous read, invokes the completion callback when the read is done.
+ */
+int NimBLERemoteValueAttribute::onAsyncReadCB(uint16_t              conn_handle,
+                                              const ble_gatt_error* error,
+                                              ble_gatt_attr*        attr,
+                                              void*                 arg) {
+    auto pOp = static_cast<AsyncOp*>(arg);
+    int  rc  = error->status;
+
+    if (rc == 0 && attr != nullptr) {
+        for (const os_mbuf* om = attr->om; om != nullptr; om = SLIST_NEXT(om, om_next)) {
+            size_t len = pOp->value.size();
+            pOp->value.append(om->om_data, om->om_len);
+            if (pOp->value.size() != len + om->om_len) {
+                rc = BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
+                break;
+            }
+        }
+
+        // A long read continues until BLE_HS_EDONE, a single read is complete.
+        if (rc == 0 && !pOp->shortRead) {
+            return 0;
+        }
+    }
+
+    auto pAtt = pOp->pAtt;
+    switch (rc) {
+        case 0:
+        case BLE_HS_EDONE:
+            rc = 0;
+            break;
+        case BLE_HS_ATT_ERR(BLE_ATT_ERR_ATTR_NOT_LONG):
+            pAtt->m_shortRead = true;
+            rc                = 0;
+            break;
+        case BLE_HS_ATT_ERR(BLE_ATT_ERR_INVALID_OFFSET):
+            rc = pOp->value.size() ? 0 : rc;
+            break;
+        default:
+            break;
+    }
+
+    if (rc == 0) {
+        pOp->value.setTimeStamp();
+        pAtt->m_value = pOp->value;
+    } else {
+        NIMBLE_LOGE(LOG_TAG, "<< readValueAsync failed rc=%d, %s", rc, NimBLEUtils::returnCodeToString(rc));
+    }
+
+    if (pOp->readCb != nullptr) {
+        pOp->readCb(pAtt, pOp->value, rc);
+    }
+
+    delete pOp;
+    return rc;
+} // onAsyncReadCB
+
+/**
+ * @brief Callback for an asynchronous write, invokes the completion callback.
+ */
+int NimBLERemoteValueAttribute::onAsyncWriteCB(uint16_t              conn_handle,
+                                               const ble_gatt_error* error,
+                                               ble_gatt_attr*        attr,
+                                               void*                 arg) {
+    auto pOp = static_cast<AsyncOp*>(arg);
+    NIMBLE_LOGI(LOG_TAG, "Async write complete; status=%d", error->status);
+
+    if (pOp->writeCb != nullptr) {
+        pOp->writeCb(pOp->pAtt, error->status);
+    }
+
+    delete pOp;
+    return 0;
+} // onAsyncWriteCB
+
+/**
+ * @brief Callback for a single Read Request, called once with the response or an error.
+ * @return success == 0 or error code.
+ */
+int NimBLERemoteValueAttribute::onShortReadCB(uint16_t              conn_handle,
+                                              const ble_gatt_error* error,
+                                              ble_gatt_attr*        attr,
+                                              void*                 arg) {
+    auto       pTaskData = static_cast<NimBLETaskData*>(arg);
+    const auto pAtt      = static_cast<NimBLERemoteValueAttribute*>(pTaskData->m_pInstance);
+
+    if (error->status != BLE_HS_ENOTCONN && pAtt->getClient()->getConnHandle() != conn_handle) {
+        return 0;
+    }
+
+    int rc = error->status;
+    NIMBLE_LOGI(LOG_TAG, "Read complete; status=%d", rc);
+
+    if (rc == 0 && attr) {
+        auto     valBuf   = static_cast<NimBLEAttValue*>(pTaskData->m_pBuf);
+        uint16_t data_len = OS_MBUF_PKTLEN(attr->om);
+        if (!valBuf->setValue(attr->om->om_data, data_len)) {
+            rc = BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
+        }
+    }
+
+    NimBLEUtils::taskRelease(*pTaskData, rc);
+    return rc;
+} // onShortReadCB
+
 #endif // CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_CENTRAL)
@@ -35,16 +35,30 @@
 # include "NimBLEValueAttribute.h"
 # include "NimBLEAttValue.h"
 
+# include <functional>
+
 class NimBLEClient;
 
 class NimBLERemoteValueAttribute : public NimBLEValueAttribute, public NimBLEAttribute {
   public:
+    /**
+     * @brief Completion callback of readValueAsync.
+     * @details rc is 0 on success, value holds the value read and is also stored in the attribute.
+     */
+    typedef std::function<void(NimBLERemoteValueAttribute* pAttr, const NimBLEAttValue& value, int rc)> read_callback;
+
+    /**
+     * @brief Completion callback of the asynchronous write operations, rc is 0 on success.
+     */
+    typedef std::function<void(NimBLERemoteValueAttribute* pAttr, int rc)> write_callback;
+
     /**
      * @brief Read the value of the remote attribute.
      * @param [in] timestamp A pointer to a time_t struct to store the time the value was read.
      * @return The value of the remote attribute.
      */
     NimBLEAttValue readValue(time_t* timestamp = nullptr);
+    bool           readValueAsync(read_callback callback);
 
     /**
      * Get the client instance that owns this attribute.
@@ -59,6 +73,7 @@ class NimBLERemoteValueAttribute : public NimBLEValueAttribute, public NimBLEAtt
      * @return false if not connected or otherwise cannot perform write.
      */
     bool writeValue(const uint8_t* data, size_t length, bool response = false) const;
+    bool writeValueAsync(const uint8_t* data, size_t length, write_callback callback) const;
 
     /**
      * @brief Write a new value to the remote characteristic from a const char*.
@@ -180,6 +195,19 @@ class NimBLERemoteValueAttribute : public NimBLEValueAttribute, public NimBLEAtt
         return getValue<T>(timestamp, skipSizeCheck);
     }
 
+    /**
+     * @brief Template to read the remote value and decode it into fields with a NimBLESchema.
+     * @tparam Schema The NimBLESchema type describing the payload layout.
+     * @param [out] values References to the variables to receive the field values, in schema order.
+     * @return True if the read succeeded and the value was at least the schema size.
+     * @details <b>Use:</b> <tt>readFields<MySchema>(field1, field2, ...);</tt>
+     */
+    template <typename Schema, typename... Args>
+    bool readFields(Args&... values) {
+        NimBLEAttValue value{};
+        return performRead(value) == 0 && value.getFields<Schema>(values...);
+    }
+
   protected:
     /**
      * @brief Construct a new NimBLERemoteValueAttribute object.
@@ -191,8 +219,17 @@ class NimBLERemoteValueAttribute : public NimBLEValueAttribute, public NimBLEAtt
      */
     virtual ~NimBLERemoteValueAttribute() = default;
 
+    int        performRead(NimBLEAttValue& value, time_t* timestamp = nullptr);
     static int onReadCB(uint16_t conn_handle, const ble_gatt_error* error, ble_gatt_attr* attr, void* arg);
+    static int onShortReadCB(uint16_t conn_handle, const ble_gatt_error* error, ble_gatt_attr* attr, void* arg);
     static int onWriteCB(uint16_t conn_handle, const ble_gatt_error* error, ble_gatt_attr* attr, void* arg);
+
+    struct AsyncOp;
+    int        writeAsync(const uint8_t* data, size_t length, write_callback callback) const;
+    static int onAsyncReadCB(uint16_t conn_handle, const ble_gatt_error* error, ble_gatt_attr* attr, void* arg);
+    static int onAsyncWriteCB(uint16_t conn_handle, const ble_gatt_error* error, ble_gatt_attr* attr, void* arg);
+
+    bool m_shortRead{false}; // The peer reported the attribute is not long-readable, use a single Read Request.
 };
 
 #endif // CONFIG_BT_NIMBLE_ENABLED && MYNEWT_VAL(BLE_ROLE_CENTRAL)
@@ -25,25 +25,175 @@
 #  include "NimBLEClient.h"
 # endif
 
+# ifndef USING_NIMBLE_ARDUINO_HEADERS
+#  if !defined(ESP_IDF_VERSION_MAJOR) || ESP_IDF_VERSION_MAJOR < 5
+#   define ble_gatts_notify_custom ble_gattc_notify_custom
+#  endif
+# endif
+
 # ifdef USING_NIMBLE_ARDUINO_HEADERS
 #  include "nimble/nimble/host/services/gap/include/services/gap/ble_svc_gap.h"
 #  include "nimble/nimble/host/services/gatt/include/services/gatt/ble_svc_gatt.h"
+#  include "nimble/porting/nimble/include/nimble/nimble_port.h"
 # else
 #  include "services/gap/ble_svc_gap.h"
 #  include "services/gatt/ble_svc_gatt.h"
+#  include "nimble/nimble_port.h"
+# endif
+
+# if __has_include("mbedtls/cmac.h")
+#  include "mbedtls/cmac.h"
+# endif
+
+# if defined(MBEDTLS_CMAC_C)
+#  define NIMBLE_CPP_DB_HASH_SUPPORTED 1
+# else
+#  define NIMBLE_CPP_DB_HASH_SUPPORTED 0
 # endif
 
+# include <deque>
+# include <utility>
+
 # define NIMBLE_SERVER_GET_PEER_NAME_ON_CONNECT_CB 0
 # define NIMBLE_SERVER_GET_PEER_NAME_ON_AUTH_CB    1
 
 static const char*           LOG_TAG = "NimBLEServer";
 static NimBLEServerCallbacks defaultCallbacks;
 
+struct dbHashSvcRange {
+    const ble_gatt_svc_def* svcDef;
+    uint16_t                startHandle;
+    uint16_t                endHandle;
+};
+
 struct gattRegisterCallbackArgs {
-    NimBLEService*        pSvc{nullptr};
-    NimBLECharacteristic* pChar{nullptr};
+    NimBLEService*                           pSvc{nullptr};
+    NimBLECharacteristic*                    pChar{nullptr};
+    std::vector<uint8_t>                     dbHashInput{};
+    std::vector<dbHashSvcRange>              dbHashSvcs{};     // registered services, in handle order
+    std::vector<std::pair<size_t, uint16_t>> dbHashExtProps{}; // hash input offset and handle of each 0x2900
+    ble_gatt_chr_flags                       chrFlags{0};
 };
 
+/**
+ * @brief Append the handle and type of an attribute to the database hash input.
+ * @param [in] in The hash input buffer.
+ * @param [in] handle The attribute handle.
+ * @param [in] type The 16 bit attribute type.
+ */
+static void dbHashAddAttr(std::vector<uint8_t>& in, uint16_t handle, uint16_t type) {
+    in.push_back(handle & 0xFF);
+    in.push_back(handle >> 8);
+    in.push_back(type & 0xFF);
+    in.push_back(type >> 8);
+} // dbHashAddAttr
+
+/**
+ * @brief Append a UUID to the database hash input as it appears in a declaration value.
+ * @param [in] in The hash input buffer.
+ * @param [in] uuid The UUID, 32 bit UUIDs are expanded to 128 bits as they are in ATT.
+ */
+static void dbHashAddUuid(std::vector<uint8_t>& in, const ble_uuid_t* uuid) {
+    NimBLEUUID value(uuid);
+    if (value.bitSize() == BLE_UUID_TYPE_32) {
+        value.to128();
+    }
+
+    const uint8_t* data = value.getValue();
+    in.insert(in.end(), data, data + value.bitSize() / 8);
+} // dbHashAddUuid
+
+/**
+ * @brief Per connection indication queues, serviced from the NimBLE host task.
+ * @details Only one indication can be outstanding on a connection, the item at the front of a
+ * connection queue is the one in flight and is released when the peer confirms it.
+ */
+struct NimBLEServer::IndicationPipeline {
+    /** @brief An indication waiting to be sent or confirmed. */
+    struct Item {
+        NimBLECharacteristic* pChr{nullptr};
+        uint16_t              attrHandle{0};
+        std::vector<uint8_t>  value{};
+        IndicationCallback    cb{nullptr};
+    };
+
+    /** @brief A completion to report once the lock has been released. */
+    struct Done {
+        NimBLECharacteristic* pChr;
+        uint16_t              connHandle;
+        int                   rc;
+        IndicationCallback    cb;
+    };
+
+    /** @brief An indication taken from the front of a queue to be sent once the lock has been released. */
+    struct Send {
+        uint16_t             connHandle;
+        uint16_t             attrHandle;
+        std::vector<uint8_t> value;
+        int                  rc;
+    };
+
+    /** @brief The indication queue of a connection. */
+    struct Conn {
+        uint16_t         connHandle{BLE_HS_CONN_HANDLE_NONE};
+        std::deque<Item> items{};
+        ble_npl_time_t   sentAt{0};
+        bool             inFlight{false};
+        bool             sending{false};       // The front item is being handed to the stack.
+        bool             directPending{false}; // An indication sent with indicate() is outstanding.
+        bool             timedOut{false};
+    };
+
+    /** @brief Construct the pipeline. */
+    IndicationPipeline(NimBLEServer* pServer) {
+        memset(&m_mutex, 0, sizeof(m_mutex));
+        if (ble_npl_mutex_init(&m_mutex) != BLE_NPL_OK) {
+            NIMBLE_LOGE(LOG_TAG, "Failed to initialize indication queue mutex");
+            return;
+        }
+
+        if (ble_npl_callout_init(&m_timer, nimble_port_get_dflt_eventq(), NimBLEServer::indicationEventCb, pServer) !=
+            0) {
+            NIMBLE_LOGE(LOG_TAG, "Failed to initialize indication queue callout");
+            ble_npl_mutex_deinit(&m_mutex);
+            return;
+        }
+
+        ble_npl_event_init(&m_event, NimBLEServer::indicationEventCb, pServer);
+        m_valid = true;
+    }
+
+    /** @brief Destroy the pipeline and release resources. */
+    ~IndicationPipeline() {
+        if (!m_valid) {
+            return;
+        }
+
+        ble_npl_callout_stop(&m_timer);
+        ble_npl_callout_deinit(&m_timer);
+        ble_npl_eventq_remove(nimble_port_get_dflt_eventq(), &m_event);
+        ble_npl_event_deinit(&m_event);
+        ble_npl_mutex_deinit(&m_mutex);
+    }
+
+    /** @brief Find the queue of a connection, BLE_HS_CONN_HANDLE_NONE finds an unused queue. */
+    Conn* find(uint16_t connHandle) {
+        for (auto& conn : m_conns) {
+            if (conn.connHandle == connHandle) {
+                return &conn;
+            }
+        }
+        return nullptr;
+    }
+
+    std::array<Conn, MYNEWT_VAL(BLE_MAX_CONNECTIONS)> m_conns{};
+    ble_npl_time_t                                    m_timeout{0};
+    bool                                              m_valid{false};
+    ble_npl_mutex                                     m_mutex{};
+    ble_npl_event                                     m_event{};
+    ble_npl_callout                                   m_timer{};
+}; // IndicationPipeline
+
 /**
  * @brief Construct a BLE Server
  *
@@ -54,13 +204,12 @@ NimBLEServer::NimBLEServer()
     : m_gattsStarted{false},
       m_svcChanged{false},
       m_deleteCallbacks{false},
+      m_dbHashValid{false},
 # if !MYNEWT_VAL(BLE_EXT_ADV)
       m_advertiseOnDisconnect{false},
 # endif
       m_pServerCallbacks{&defaultCallbacks},
-      m_svcVec{} {
-    m_connectedPeers.fill(BLE_HS_CONN_HANDLE_NONE);
-} // NimBLEServer
+      m_svcVec{} {} // NimBLEServer
 
 /**
  * @brief Destructor: frees all resources / attributes created.
@@ -79,6 +228,10 @@ NimBLEServer::~NimBLEServer() {
         delete m_pClient;
     }
 # endif
+
+    if (m_pIndPipeline) {
+        delete m_pIndPipeline;
+    }
 }
 
 /**
@@ -138,10 +291,8 @@ NimBLEService* NimBLEServer::getServiceByUUID(const NimBLEUUID& uuid, uint16_t i
  * @return A pointer to the service object or nullptr if not found.
  */
 NimBLEService* NimBLEServer::getServiceByHandle(uint16_t handle) const {
-    for (const auto& svc : m_svcVec) {
-        if (svc->getHandle() == handle) {
-            return svc;
-        }
+    if (handle < m_handleTable.size() && m_handleTable[handle].type == BLE_GATT_REGISTER_OP_SVC) {
+        return static_cast<NimBLEService*>(m_handleTable[handle].pAttr);
     }
 
     return nullptr;
@@ -153,12 +304,10 @@ NimBLEService* NimBLEServer::getServiceByHandle(uint16_t handle) const {
  * @return A pointer to the characteristic object or nullptr if not found.
  */
 NimBLECharacteristic* NimBLEServer::getCharacteristicByHandle(uint16_t handle) const {
-    for (const auto& svc : m_svcVec) {
-        NimBLECharacteristic* pChr = svc->getCharacteristicByHandle(handle);
-        if (pChr != nullptr) {
-            return pChr;
-        }
+    if (handle < m_handleTable.size() && m_handleTable[handle].type == BLE_GATT_REGISTER_OP_CHR) {
+        return static_cast<NimBLECharacteristic*>(m_handleTable[handle].pAttr);
     }
+
     return nullptr;
 } // getCharacteristicByHandle
 
@@ -200,6 +349,28 @@ void NimBLEServer::sendServiceChangedIndication() const {
     ble_svc_gatt_changed(0x0001, 0xffff);
 }
 
+/**
+ * @brief Get the Database Hash of the local GATT database.
+ * @param [out] hash Receives the 128 bit hash, in the little endian order it is sent over the air.
+ * @return True if the hash is available, false if the server has not been started or the hash could not be computed.
+ * @details The hash is computed when the server is started as defined in the Core Specification (v5.1+, Vol 3,
+ * Part G, 7.3) and changes only when services, includes, characteristics or descriptors are added, removed or moved.
+ * If a restart of the server produces the same hash the Service Changed indication is not sent.\n
+ * This library does not serve the Database Hash or Client Supported Features characteristics, these are part of
+ * the GATT service of the NimBLE stack and only exist when it is built with GATT caching support
+ * (CONFIG_BT_NIMBLE_GATT_CACHING). Without it clients cannot use robust caching and rediscover after the
+ * Service Changed indication. The stack computes the value it serves on its own, attributes it adds without a
+ * registration event, other than the Client Characteristic Configuration descriptor, are not part of this hash.
+ */
+bool NimBLEServer::getDatabaseHash(std::array<uint8_t, 16>& hash) const {
+    if (!m_dbHashValid) {
+        return false;
+    }
+
+    hash = m_dbHash;
+    return true;
+} // getDatabaseHash
+
 /**
  * @brief Callback for GATT registration events,
  * used to obtain the assigned handles for services, characteristics, and descriptors.
@@ -210,12 +381,96 @@ void NimBLEServer::sendServiceChangedIndication() const {
 void NimBLEServer::gattRegisterCallback(ble_gatt_register_ctxt* ctxt, void* arg) {
     gattRegisterCallbackArgs* args = static_cast<gattRegisterCallbackArgs*>(arg);
 
+    // Collect the attributes that make up the Database Hash (Core Spec v5.1+, Vol 3, Part G, 7.3),
+    // registration events arrive in handle order for every service including GAP and GATT.
+    switch (ctxt->op) {
+        case BLE_GATT_REGISTER_OP_SVC: {
+            // A service ends where the next one starts, which is all that is needed to hash the includes.
+            if (!args->dbHashSvcs.empty()) {
+                args->dbHashSvcs.back().endHandle = ctxt->svc.handle - 1;
+            }
+            args->dbHashSvcs.push_back({ctxt->svc.svc_def, ctxt->svc.handle, 0xFFFF});
+
+            dbHashAddAttr(args->dbHashInput,
+                          ctxt->svc.handle,
+                          ctxt->svc.svc_def->type == BLE_GATT_SVC_TYPE_PRIMARY ? BLE_ATT_UUID_PRIMARY_SERVICE
+                                                                               : BLE_ATT_UUID_SECONDARY_SERVICE);
+            dbHashAddUuid(args->dbHashInput, ctxt->svc.svc_def->uuid);
+
+            // The stack registers the include declarations directly after the service, without registration
+            // events, and only once the included services have been registered.
+            uint16_t incHandle = ctxt->svc.handle + 1;
+            for (auto inc = ctxt->svc.svc_def->includes; inc && *inc; ++inc, ++incHandle) {
+                for (const auto& range : args->dbHashSvcs) {
+                    if (range.svcDef == *inc) {
+                        dbHashAddAttr(args->dbHashInput, incHandle, BLE_ATT_UUID_INCLUDE);
+                        args->dbHashInput.push_back(range.startHandle & 0xFF);
+                        args->dbHashInput.push_back(range.startHandle >> 8);
+                        args->dbHashInput.push_back(range.endHandle & 0xFF);
+                        args->dbHashInput.push_back(range.endHandle >> 8);
+                        // Only 16 bit UUIDs are part of the include declaration value.
+                        if ((*inc)->uuid->type == BLE_UUID_TYPE_16) {
+                            dbHashAddUuid(args->dbHashInput, (*inc)->uuid);
+                        }
+                        break;
+                    }
+                }
+            }
+            break;
+        }
+
+        case BLE_GATT_REGISTER_OP_CHR: {
+            const ble_gatt_chr_flags flags = ctxt->chr.chr_def->flags;
+            uint8_t                  props = flags & 0x7F;
+            if (flags & (BLE_GATT_CHR_F_RELIABLE_WRITE | BLE_GATT_CHR_F_AUX_WRITE)) {
+                props |= BLE_GATT_CHR_PROP_EXTENDED;
+            }
+
+            dbHashAddAttr(args->dbHashInput, ctxt->chr.def_handle, BLE_ATT_UUID_CHARACTERISTIC);
+            args->dbHashInput.push_back(props);
+            args->dbHashInput.push_back(ctxt->chr.val_handle & 0xFF);
+            args->dbHashInput.push_back(ctxt->chr.val_handle >> 8);
+            dbHashAddUuid(args->dbHashInput, ctxt->chr.chr_def->uuid);
+
+            // The stack adds the CCCD directly after the value without a registration event.
+            if (flags & (BLE_GATT_CHR_F_NOTIFY | BLE_GATT_CHR_F_INDICATE)) {
+                dbHashAddAttr(args->dbHashInput, ctxt->chr.val_handle + 1, BLE_GATT_DSC_CLT_CFG_UUID16);
+            }
+
+            args->chrFlags = flags;
+            break;
+        }
+
+        case BLE_GATT_REGISTER_OP_DSC: {
+            const ble_uuid_t* uuid = ctxt->dsc.dsc_def->uuid;
+            if (uuid->type == BLE_UUID_TYPE_16) {
+                const uint16_t uuid16 = BLE_UUID16(uuid)->value;
+                if (uuid16 >= 0x2900 && uuid16 <= 0x2905) {
+                    dbHashAddAttr(args->dbHashInput, ctxt->dsc.handle, uuid16);
+                    if (uuid16 == 0x2900) {
+                        // Expected value, replaced by the one served once the database is started.
+                        args->dbHashExtProps.push_back({args->dbHashInput.size(), ctxt->dsc.handle});
+                        args->dbHashInput.push_back((args->chrFlags & BLE_GATT_CHR_F_RELIABLE_WRITE ? 0x01 : 0) |
+                                                    (args->chrFlags & BLE_GATT_CHR_F_AUX_WRITE ? 0x02 : 0));
+                        args->dbHashInput.push_back(0);
+                    }
+                }
+            }
+            break;
+        }
+
+        default:
+            break;
+    }
+
     if (ctxt->op == BLE_GATT_REGISTER_OP_SVC) {
         NimBLEUUID uuid(ctxt->svc.svc_def->uuid);
         args->pSvc = nullptr;
         for (auto pSvc : NimBLEDevice::getServer()->m_svcVec) {
-            if (!pSvc->getRemoved() && pSvc->m_handle == 0 && pSvc->getUUID() == uuid) {
+            // Match the definition rather than the UUID so services from static tables are never claimed.
+            if (!pSvc->getRemoved() && pSvc->m_handle == 0 && pSvc->m_pSvcDef == ctxt->svc.svc_def) {
                 pSvc->m_handle = ctxt->svc.handle;
+                NimBLEDevice::getServer()->setHandleEntry(ctxt->svc.handle, pSvc, BLE_GATT_REGISTER_OP_SVC);
                 NIMBLE_LOGD(LOG_TAG, "Service registered: %s, handle=%d", uuid.toString().c_str(), ctxt->svc.handle);
                 // Set the arg to the service so we know that the following
                 // characteristics and descriptors belong to this service
@@ -238,8 +493,9 @@ void NimBLEServer::gattRegisterCallback(ble_gatt_register_ctxt* ctxt, void* arg)
         NimBLEUUID uuid(ctxt->chr.chr_def->uuid);
         args->pChar = nullptr;
         for (auto pChr : args->pSvc->m_vChars) {
-            if (!pChr->getRemoved() && pChr->m_handle == 0 && pChr->getUUID() == uuid) {
+            if (!pChr->getRemoved() && pChr->m_handle == 0 && ctxt->chr.chr_def->arg == pChr) {
                 pChr->m_handle = ctxt->chr.val_handle;
+                NimBLEDevice::getServer()->setHandleEntry(ctxt->chr.val_handle, pChr, BLE_GATT_REGISTER_OP_CHR);
                 // Set the arg to the characteristic so we know that the following descriptors belong to this characteristic
                 args->pChar    = pChr;
                 NIMBLE_LOGD(LOG_TAG,
@@ -262,7 +518,7 @@ void NimBLEServer::gattRegisterCallback(ble_gatt_register_ctxt* ctxt, void* arg)
 
         NimBLEUUID uuid(ctxt->dsc.dsc_def->uuid);
         for (auto pDsc : args->pChar->m_vDescriptors) {
-            if (!pDsc->getRemoved() && pDsc->m_handle == 0 && pDsc->getUUID() == uuid) {
+            if (!pDsc->getRemoved() && pDsc->m_handle == 0 && ctxt->dsc.dsc_def->arg == pDsc) {
                 pDsc->m_handle = ctxt->dsc.handle;
                 NIMBLE_LOGD(LOG_TAG, "Descriptor registered: %s, handle=%d", uuid.toString().c_str(), ctxt->dsc.handle);
                 return;
@@ -271,6 +527,27 @@ void NimBLEServer::gattRegisterCallback(ble_gatt_register_ctxt* ctxt, void* arg)
     }
 }
 
+/**
+ * @brief Set or clear an entry of the handle lookup table.
+ * @param [in] handle The attribute handle.
+ * @param [in] pAttr The attribute the handle belongs to, or nullptr to clear the entry.
+ * @param [in] type The BLE_GATT_REGISTER_OP_* type of the attribute.
+ * @details The table is indexed directly by handle so that handle lookups from GAP/GATT events
+ * do not need to search the services and characteristics.
+ */
+void NimBLEServer::setHandleEntry(uint16_t handle, NimBLELocalAttribute* pAttr, uint8_t type) {
+    if (handle >= m_handleTable.size()) {
+        if (pAttr == nullptr) {
+            return;
+        }
+
+        m_handleTable.resize(handle + 1);
+    }
+
+    m_handleTable[handle].pAttr = pAttr;
+    m_handleTable[handle].type  = pAttr ? type : 0;
+} // setHandleEntry
+
 /**
  * @brief Start the GATT server.
  * @details Required to be called after setup of all services and characteristics / descriptors
@@ -300,6 +577,47 @@ bool NimBLEServer::start() {
         return false;
     }
 
+    m_handleTable.shrink_to_fit();
+
+    std::array<uint8_t, 16> dbHash{};
+    const bool              prevHashValid = m_dbHashValid;
+    m_dbHashValid                         = false;
+# if NIMBLE_CPP_DB_HASH_SUPPORTED
+    // The Extended Properties value is part of the hash, use the one the descriptor actually serves.
+    for (const auto& extProps : args.dbHashExtProps) {
+        os_mbuf* om = nullptr;
+        if (ble_att_svr_read_local(extProps.second, &om) == 0) {
+            uint8_t value[2];
+            if (OS_MBUF_PKTLEN(om) == sizeof(value) && os_mbuf_copydata(om, 0, sizeof(value), value) == 0) {
+                args.dbHashInput[extProps.first]     = value[0];
+                args.dbHashInput[extProps.first + 1] = value[1];
+            }
+        }
+
+        if (om) {
+            os_mbuf_free_chain(om);
+        }
+    }
+
+    // The hash is AES-CMAC with a zero key over the collected attributes, output in little endian order.
+    static const uint8_t zeroKey[16]{};
+    uint8_t              mac[16];
+    rc = mbedtls_cipher_cmac(mbedtls_cipher_info_from_type(MBEDTLS_CIPHER_AES_128_ECB),
+                             zeroKey,
+                             128,
+                             args.dbHashInput.data(),
+                             args.dbHashInput.size(),
+                             mac);
+    if (rc == 0) {
+        for (size_t i = 0; i < sizeof(mac); i++) {
+            dbHash[i] = mac[sizeof(mac) - 1 - i];
+        }
+        m_dbHashValid = true;
+    } else {
+        NIMBLE_LOGE(LOG_TAG, "Database hash calculation failed, rc=%d", rc);
+    }
+# endif
+
 # if MYNEWT_VAL(NIMBLE_CPP_LOG_LEVEL) >= 4
     ble_gatts_show_local();
 
@@ -317,12 +635,19 @@ bool NimBLEServer::start() {
     }
 # endif
 
-    // If the services have changed indicate it now
+    // If the services have changed indicate it now, unless the rebuilt database is identical to the previous one
+    // in which case the clients' caches are still valid and rediscovery would only cost time.
     if (m_svcChanged) {
         m_svcChanged = false;
-        sendServiceChangedIndication();
+        if (prevHashValid && m_dbHashValid && dbHash == m_dbHash) {
+            NIMBLE_LOGD(LOG_TAG, "Database hash unchanged, not sending service changed indication");
+        } else {
+            sendServiceChangedIndication();
+        }
     }
 
+    m_dbHash = dbHash;
+
     m_gattsStarted = true;
     return true;
 } // start
@@ -371,14 +696,7 @@ void NimBLEServer::advertiseOnDisconnect(bool enable) {
  * @return The number of connected clients.
  */
 uint8_t NimBLEServer::getConnectedCount() const {
-    size_t count = 0;
-    for (const auto& peer : m_connectedPeers) {
-        if (peer != BLE_HS_CONN_HANDLE_NONE) {
-            count++;
-        }
-    }
-
-    return count;
+    return m_connCount;
 } // getConnectedCount
 
 /**
@@ -387,31 +705,136 @@ uint8_t NimBLEServer::getConnectedCount() const {
  */
 std::vector<uint16_t> NimBLEServer::getPeerDevices() const {
     std::vector<uint16_t> peers{};
-    for (const auto& peer : m_connectedPeers) {
-        if (peer != BLE_HS_CONN_HANDLE_NONE) {
-            peers.push_back(peer);
+    peers.reserve(m_connCount);
+    for (const auto& peer : m_peers) {
+        if (peer.connHandle != BLE_HS_CONN_HANDLE_NONE) {
+            peers.push_back(peer.connHandle);
         }
     }
 
     return peers;
 } // getPeerDevices
 
+/**
+ * @brief Get the compact index of a connection.
+ * @param [in] connHandle The connection handle of the peer.
+ * @return The index of the slot the connection occupies, from 0 to BLE_MAX_CONNECTIONS - 1, or -1 if the peer
+ * is not connected to the server.
+ * @details The index is stable for the lifetime of the connection and is reused once the peer disconnects.
+ * Connections are placed at their handle modulo the table size, so this normally finds the slot on the first probe.
+ */
+int NimBLEServer::getConnIndex(uint16_t connHandle) const {
+    if (connHandle == BLE_HS_CONN_HANDLE_NONE) {
+        return -1;
+    }
+
+    const size_t numSlots = m_peers.size();
+    size_t       index    = connHandle % numSlots;
+    for (size_t i = 0; i < numSlots; i++) {
+        if (m_peers[index].connHandle == connHandle) {
+            return static_cast<int>(index);
+        }
+
+        index = (index + 1) % numSlots;
+    }
+
+    return -1;
+} // getConnIndex
+
+/**
+ * @brief Add a new connection to the peer table.
+ * @param [in] desc The connection descriptor from the host.
+ * @return True if a slot was available.
+ */
+bool NimBLEServer::addPeer(const ble_gap_conn_desc& desc) {
+    const size_t numSlots = m_peers.size();
+    size_t       index    = desc.conn_handle % numSlots;
+    for (size_t i = 0; i < numSlots; i++) {
+        PeerEntry& peer = m_peers[index];
+        if (peer.connHandle == BLE_HS_CONN_HANDLE_NONE) {
+            ble_npl_hw_enter_critical();
+            peer.desc       = desc;
+            peer.mtu        = ble_att_mtu(desc.conn_handle);
+            peer.txPhy      = 0;
+            peer.rxPhy      = 0;
+            peer.connHandle = desc.conn_handle;
+            ble_npl_hw_exit_critical(0);
+            m_connCount++;
+            return true;
+        }
+
+        index = (index + 1) % numSlots;
+    }
+
+    return false;
+} // addPeer
+
+/**
+ * @brief Remove a closed connection from the peer table.
+ * @param [in] connHandle The connection handle of the peer.
+ */
+void NimBLEServer::removePeer(uint16_t connHandle) {
+    int index = getConnIndex(connHandle);
+    if (index >= 0) {
+        m_peers[index].connHandle = BLE_HS_CONN_HANDLE_NONE;
+        m_connCount--;
+    }
+} // removePeer
+
+/**
+ * @brief Update the cached connection descriptor of a peer after its parameters or security changed.
+ * @param [in] connHandle The connection handle of the peer.
+ */
+void NimBLEServer::refreshPeer(uint16_t connHandle) {
+    int index = getConnIndex(connHandle);
+    if (index < 0) {
+        return;
+    }
+
+    ble_gap_conn_desc desc;
+    if (ble_gap_conn_find(connHandle, &desc) == 0) {
+        ble_npl_hw_enter_critical();
+        m_peers[index].desc = desc;
+        ble_npl_hw_exit_critical(0);
+    }
+} // refreshPeer
+
+/**
+ * @brief Get the connection information of a peer, from the peer table if it is a client of the server.
+ * @param [in] connHandle The connection handle of the peer.
+ * @param [out] connInfo Receives the connection information.
+ * @return True if the connection was found.
+ * @details Connections that are not in the peer table, such as those where this device is the central,
+ * are looked up in the host.
+ */
+bool NimBLEServer::findPeerInfo(uint16_t connHandle, NimBLEConnInfo& connInfo) const {
+    int index = getConnIndex(connHandle);
+    if (index < 0) {
+        return ble_gap_conn_find(connHandle, &connInfo.m_desc) == 0;
+    }
+
+    ble_npl_hw_enter_critical();
+    connInfo.m_desc = m_peers[index].desc;
+    ble_npl_hw_exit_critical(0);
+    return true;
+} // findPeerInfo
+
 /**
  * @brief Get the connection information of a connected peer by vector index.
  * @param [in] index The vector index of the peer.
  * @return A NimBLEConnInfo instance with the peer connection information, or an empty instance if not found.
  */
 NimBLEConnInfo NimBLEServer::getPeerInfo(uint8_t index) const {
-    if (index >= m_connectedPeers.size()) {
+    if (index >= m_peers.size()) {
         NIMBLE_LOGE(LOG_TAG, "Invalid index %u", index);
         return NimBLEConnInfo{};
     }
 
     auto count = 0;
-    for (const auto& peer : m_connectedPeers) {
-        if (peer != BLE_HS_CONN_HANDLE_NONE) {
+    for (const auto& peer : m_peers) {
+        if (peer.connHandle != BLE_HS_CONN_HANDLE_NONE) {
             if (count == index) {
-                return getPeerInfoByHandle(peer);
+                return getPeerInfoByHandle(peer.connHandle);
             }
             count++;
         }
@@ -441,7 +864,7 @@ NimBLEConnInfo NimBLEServer::getPeerInfo(const NimBLEAddress& address) const {
  */
 NimBLEConnInfo NimBLEServer::getPeerInfoByHandle(uint16_t connHandle) const {
     NimBLEConnInfo peerInfo{};
-    if (ble_gap_conn_find(connHandle, &peerInfo.m_desc) != 0) {
+    if (!findPeerInfo(connHandle, peerInfo)) {
         NIMBLE_LOGE(LOG_TAG, "Peer info not found");
     }
 
@@ -476,12 +899,7 @@ int NimBLEServer::handleGapEvent(ble_gap_event* event, void* arg) {
                     return 0;
                 }
 
-                for (auto& peer : pServer->m_connectedPeers) {
-                    if (peer == BLE_HS_CONN_HANDLE_NONE) {
-                        peer = event->connect.conn_handle;
-                        break;
-                    }
-                }
+                pServer->addPeer(peerInfo.m_desc);
 
                 pServer->m_pServerCallbacks->onConnect(pServer, peerInfo);
             }
@@ -504,13 +922,15 @@ int NimBLEServer::handleGapEvent(ble_gap_event* event, void* arg) {
                     break;
             }
 
-            for (auto& peer : pServer->m_connectedPeers) {
-                if (peer == event->disconnect.conn.conn_handle) {
-                    peer = BLE_HS_CONN_HANDLE_NONE;
-                    break;
-                }
+            // Release per connection values while the connection still has its slot.
+            for (auto* pChr : pServer->m_peerValueChrs) {
+                pChr->clearPeerValue(event->disconnect.conn.conn_handle);
             }
 
+            pServer->removePeer(event->disconnect.conn.conn_handle);
+
+            pServer->flushIndications(event->disconnect.conn.conn_handle, nullptr, BLE_HS_ENOTCONN);
+
 # if MYNEWT_VAL(BLE_ROLE_CENTRAL)
             if (pServer->m_pClient && pServer->m_pClient->m_connHandle == event->disconnect.conn.conn_handle) {
                 // If this was also the client make sure it's flagged as disconnected.
@@ -529,8 +949,7 @@ int NimBLEServer::handleGapEvent(ble_gap_event* event, void* arg) {
         } // BLE_GAP_EVENT_DISCONNECT
 
         case BLE_GAP_EVENT_SUBSCRIBE: {
-            rc = ble_gap_conn_find(event->subscribe.conn_handle, &peerInfo.m_desc);
-            if (rc != 0) {
+            if (!pServer->findPeerInfo(event->subscribe.conn_handle, peerInfo)) {
                 break;
             }
 
@@ -539,7 +958,9 @@ int NimBLEServer::handleGapEvent(ble_gap_event* event, void* arg) {
 
             auto pChar = pServer->getCharacteristicByHandle(event->subscribe.attr_handle);
             if (!pChar) {
-                NIMBLE_LOGE(LOG_TAG, "subscribe event; attr_handle=%d, not found", event->subscribe.attr_handle);
+                NIMBLE_LOGD(LOG_TAG,
+                            "subscribe event; attr_handle=%d, not a NimBLECharacteristic",
+                            event->subscribe.attr_handle);
                 break;
             }
 
@@ -549,7 +970,12 @@ int NimBLEServer::handleGapEvent(ble_gap_event* event, void* arg) {
 
         case BLE_GAP_EVENT_MTU: {
             NIMBLE_LOGI(LOG_TAG, "mtu update event; conn_handle=%d mtu=%d", event->mtu.conn_handle, event->mtu.value);
-            if (ble_gap_conn_find(event->mtu.conn_handle, &peerInfo.m_desc) == 0) {
+            int index = pServer->getConnIndex(event->mtu.conn_handle);
+            if (index >= 0) {
+                pServer->m_peers[index].mtu = event->mtu.value;
+            }
+
+            if (pServer->findPeerInfo(event->mtu.conn_handle, peerInfo)) {
                 pServer->m_pServerCallbacks->onMTUChange(event->mtu.value, peerInfo);
             }
 
@@ -557,6 +983,14 @@ int NimBLEServer::handleGapEvent(ble_gap_event* event, void* arg) {
         } // BLE_GAP_EVENT_MTU
 
         case BLE_GAP_EVENT_NOTIFY_TX: {
+            // Release the queue slot before looking up the characteristic, it may have been deleted while
+            // its indication was in flight. A status of 0 means sent but not yet acknowledged.
+            if (event->notify_tx.indication && event->notify_tx.status != 0) {
+                pServer->indicationDone(event->notify_tx.conn_handle,
+                                        event->notify_tx.attr_handle,
+                                        event->notify_tx.status);
+            }
+
             rc = ble_gap_conn_find(event->notify_tx.conn_handle, &peerInfo.m_desc);
             if (rc != 0) {
                 break;
@@ -567,10 +1001,11 @@ int NimBLEServer::handleGapEvent(ble_gap_event* event, void* arg) {
                 break;
             }
 
-            if (event->notify_tx.indication) {
-                if (event->notify_tx.status == 0) {
-                    return 0; // Indication sent but not yet acknowledged.
-                }
+            // A transmit completed, give any queued notifications a chance to use the freed resources.
+            pChar->scheduleNotifyQueueDrain();
+
+            if (event->notify_tx.indication && event->notify_tx.status == 0) {
+                return 0;
             }
 
             pChar->m_pCallbacks->onStatus(pChar, event->notify_tx.status);
@@ -597,7 +1032,8 @@ int NimBLEServer::handleGapEvent(ble_gap_event* event, void* arg) {
         } // BLE_GAP_EVENT_ADV_COMPLETE | BLE_GAP_EVENT_SCAN_REQ_RCVD
 
         case BLE_GAP_EVENT_CONN_UPDATE: {
-            if (ble_gap_conn_find(event->connect.conn_handle, &peerInfo.m_desc) == 0) {
+            pServer->refreshPeer(event->conn_update.conn_handle);
+            if (pServer->findPeerInfo(event->conn_update.conn_handle, peerInfo)) {
                 pServer->m_pServerCallbacks->onConnParamsUpdate(peerInfo);
             }
 
@@ -625,8 +1061,8 @@ int NimBLEServer::handleGapEvent(ble_gap_event* event, void* arg) {
         } // BLE_GAP_EVENT_REPEAT_PAIRING
 
         case BLE_GAP_EVENT_ENC_CHANGE: {
-            rc = ble_gap_conn_find(event->enc_change.conn_handle, &peerInfo.m_desc);
-            if (rc != 0) {
+            pServer->refreshPeer(event->enc_change.conn_handle);
+            if (!pServer->findPeerInfo(event->enc_change.conn_handle, peerInfo)) {
                 return BLE_ATT_ERR_INVALID_HANDLE;
             }
 
@@ -647,8 +1083,8 @@ int NimBLEServer::handleGapEvent(ble_gap_event* event, void* arg) {
         } // BLE_GAP_EVENT_ENC_CHANGE
 
         case BLE_GAP_EVENT_IDENTITY_RESOLVED: {
-            rc = ble_gap_conn_find(event->identity_resolved.conn_handle, &peerInfo.m_desc);
-            if (rc != 0) {
+            pServer->refreshPeer(event->identity_resolved.conn_handle);
+            if (!pServer->findPeerInfo(event->identity_resolved.conn_handle, peerInfo)) {
                 return BLE_ATT_ERR_INVALID_HANDLE;
             }
 
@@ -657,11 +1093,16 @@ int NimBLEServer::handleGapEvent(ble_gap_event* event, void* arg) {
         } // BLE_GAP_EVENT_IDENTITY_RESOLVED
 
         case BLE_GAP_EVENT_PHY_UPDATE_COMPLETE: {
-            rc = ble_gap_conn_find(event->phy_updated.conn_handle, &peerInfo.m_desc);
-            if (rc != 0) {
+            if (!pServer->findPeerInfo(event->phy_updated.conn_handle, peerInfo)) {
                 return BLE_ATT_ERR_INVALID_HANDLE;
             }
 
+            int index = pServer->getConnIndex(event->phy_updated.conn_handle);
+            if (index >= 0) {
+                pServer->m_peers[index].txPhy = event->phy_updated.tx_phy;
+                pServer->m_peers[index].rxPhy = event->phy_updated.rx_phy;
+            }
+
             pServer->m_pServerCallbacks->onPhyUpdate(peerInfo, event->phy_updated.tx_phy, event->phy_updated.rx_phy);
             return 0;
         } // BLE_GAP_EVENT_PHY_UPDATE_COMPLETE
@@ -731,10 +1172,10 @@ int NimBLEServer::handleGattEvent(uint16_t connHandle, uint16_t attrHandle, ble_
                 "Gatt %s event",
                 (ctxt->op == BLE_GATT_ACCESS_OP_READ_CHR || ctxt->op == BLE_GATT_ACCESS_OP_READ_DSC) ? "Read" : "Write");
     auto                  pAtt = static_cast<NimBLELocalValueAttribute*>(arg);
-    const NimBLEAttValue& val  = pAtt->getAttVal();
+    const NimBLEAttValue& val  = pAtt->getPeerAttVal(connHandle);
 
     NimBLEConnInfo peerInfo{};
-    ble_gap_conn_find(connHandle, &peerInfo.m_desc);
+    NimBLEDevice::getServer()->findPeerInfo(connHandle, peerInfo);
 
     switch (ctxt->op) {
         case BLE_GATT_ACCESS_OP_READ_DSC:
@@ -745,6 +1186,12 @@ int NimBLEServer::handleGattEvent(uint16_t connHandle, uint16_t attrHandle, ble_
                 pAtt->readEvent(peerInfo);
             }
 
+            if (pAtt->m_valueProvider) {
+                NimBLEReadResponse rsp(ctxt->om, val.max_size());
+                pAtt->m_valueProvider(peerInfo, rsp);
+                return rsp.m_rc;
+            }
+
             ble_npl_hw_enter_critical();
             int rc = os_mbuf_append(ctxt->om, val.data(), val.size());
             ble_npl_hw_exit_critical(0);
@@ -753,27 +1200,40 @@ int NimBLEServer::handleGattEvent(uint16_t connHandle, uint16_t attrHandle, ble_
 
         case BLE_GATT_ACCESS_OP_WRITE_DSC:
         case BLE_GATT_ACCESS_OP_WRITE_CHR: {
-            uint16_t maxLen = val.max_size();
-            uint16_t len    = ctxt->om->om_len;
-            if (len > maxLen) {
+            uint16_t len = OS_MBUF_PKTLEN(ctxt->om);
+            if (len > val.max_size()) {
                 return BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
             }
 
-            uint8_t buf[maxLen];
-            memcpy(buf, ctxt->om->om_data, len);
+            if (ctxt->op == BLE_GATT_ACCESS_OP_WRITE_CHR) {
+                auto pChr = static_cast<NimBLECharacteristic*>(pAtt);
+                if (pChr->m_pWriteRing) {
+                    return pChr->ringWriteEvent(ctxt->om, len, connHandle);
+                }
 
-            os_mbuf* next;
-            next = SLIST_NEXT(ctxt->om, om_next);
-            while (next != NULL) {
-                if ((len + next->om_len) > maxLen) {
-                    return BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
+                if (pChr->m_chunkedWrite) {
+                    uint16_t offset = 0;
+                    for (const os_mbuf* om = ctxt->om; om != nullptr; om = SLIST_NEXT(om, om_next)) {
+                        bool isLast = SLIST_NEXT(om, om_next) == nullptr;
+                        pChr->writeChunkEvent(om->om_data, om->om_len, offset, isLast, peerInfo);
+                        offset += om->om_len;
+                    }
+                    return 0;
                 }
-                memcpy(&buf[len], next->om_data, next->om_len);
-                len  += next->om_len;
-                next  = SLIST_NEXT(next, om_next);
             }
 
-            pAtt->writeEvent(buf, len, peerInfo);
+            // Most writes fit in a single mbuf and can be passed through without copying.
+            if (SLIST_NEXT(ctxt->om, om_next) == nullptr) {
+                pAtt->writeEvent(ctxt->om->om_data, len, peerInfo);
+                return 0;
+            }
+
+            std::vector<uint8_t> buf(len);
+            if (os_mbuf_copydata(ctxt->om, 0, len, buf.data()) != 0) {
+                return BLE_ATT_ERR_UNLIKELY;
+            }
+
+            pAtt->writeEvent(buf.data(), len, peerInfo);
             return 0;
         }
 
@@ -804,6 +1264,46 @@ void NimBLEServer::setCallbacks(NimBLEServerCallbacks* pCallbacks, bool deleteCa
     }
 } // setCallbacks
 
+/**
+ * @brief Add services defined by a static GATT table.
+ * @param [in] svcs The service table, terminated by an entry with type 0, see NimBLEGattTable.h.
+ * @return True if the table was added, false if it is already added or null.
+ * @details The table and everything it points to must remain valid while the server uses it, the stack
+ * registers it in place without copying. No NimBLEService or NimBLECharacteristic objects are created,
+ * attribute access is handled by the callbacks in the table. The services are registered when the server is
+ * started, tables can be added after starting which will trigger a GATT reset as with dynamic services.
+ */
+bool NimBLEServer::addStaticServices(const ble_gatt_svc_def* svcs) {
+    if (svcs == nullptr) {
+        return false;
+    }
+
+    for (const auto& existing : m_staticSvcs) {
+        if (existing == svcs) {
+            return false;
+        }
+    }
+
+    m_staticSvcs.push_back(svcs);
+    setServiceChanged();
+    return true;
+} // addStaticServices
+
+/**
+ * @brief Remove services added with addStaticServices.
+ * @param [in] svcs The service table to remove.
+ * @details The services are removed from the GATT database the next time the server is started.
+ */
+void NimBLEServer::removeStaticServices(const ble_gatt_svc_def* svcs) {
+    for (auto it = m_staticSvcs.begin(); it != m_staticSvcs.end(); ++it) {
+        if (*it == svcs) {
+            m_staticSvcs.erase(it);
+            setServiceChanged();
+            return;
+        }
+    }
+} // removeStaticServices
+
 /**
  * @brief Remove a service from the server.
  *
@@ -830,6 +1330,10 @@ void NimBLEServer::removeService(NimBLEService* service, bool deleteSvc) {
         if (deleteSvc) {
             for (auto it = m_svcVec.begin(); it != m_svcVec.end(); ++it) {
                 if ((*it) == service) {
+                    for (const auto& chr : service->m_vChars) {
+                        setHandleEntry(chr->getHandle(), nullptr, 0);
+                    }
+                    setHandleEntry(service->getHandle(), nullptr, 0);
                     delete *it;
                     m_svcVec.erase(it);
                     break;
@@ -892,6 +1396,7 @@ bool NimBLEServer::resetGATT() {
     ble_gatts_reset();
     ble_svc_gap_init();
     ble_svc_gatt_init();
+    m_handleTable.clear();
 
     for (auto svcIt = m_svcVec.begin(); svcIt != m_svcVec.end();) {
         auto* pSvc = *svcIt;
@@ -936,6 +1441,18 @@ bool NimBLEServer::resetGATT() {
         ++svcIt;
     }
 
+    for (const auto& svcs : m_staticSvcs) {
+        int rc = ble_gatts_count_cfg(svcs);
+        if (rc == 0) {
+            rc = ble_gatts_add_svcs(svcs);
+        }
+
+        if (rc != 0) {
+            NIMBLE_LOGE(LOG_TAG, "Failed to add static services, rc=%d %s", rc, NimBLEUtils::returnCodeToString(rc));
+            return false;
+        }
+    }
+
     return true;
 } // resetGATT
 
@@ -975,9 +1492,19 @@ bool NimBLEServer::updatePhy(uint16_t connHandle, uint8_t txPhyMask, uint8_t rxP
  * @return True if successful.
  */
 bool NimBLEServer::getPhy(uint16_t connHandle, uint8_t* txPhy, uint8_t* rxPhy) {
+    int index = getConnIndex(connHandle);
+    if (index >= 0 && m_peers[index].txPhy != 0) {
+        *txPhy = m_peers[index].txPhy;
+        *rxPhy = m_peers[index].rxPhy;
+        return true;
+    }
+
     int rc = ble_gap_read_le_phy(connHandle, txPhy, rxPhy);
     if (rc != 0) {
         NIMBLE_LOGE(LOG_TAG, "Failed to read phy; rc=%d %s", rc, NimBLEUtils::returnCodeToString(rc));
+    } else if (index >= 0) {
+        m_peers[index].txPhy = *txPhy;
+        m_peers[index].rxPhy = *rxPhy;
     }
 
     return rc == 0;
@@ -1035,9 +1562,592 @@ bool NimBLEServer::stopAdvertising() const {
  * @returns The MTU or 0 if not found/connected.
  */
 uint16_t NimBLEServer::getPeerMTU(uint16_t connHandle) const {
+    int index = getConnIndex(connHandle);
+    if (index >= 0) {
+        return m_peers[index].mtu;
+    }
+
     return ble_att_mtu(connHandle);
 } // getPeerMTU
 
+/**
+ * @brief Get the notification and indication transmit statistics.
+ * @returns A reference to the statistics, valid for the lifetime of the server.
+ * @details Use mbufPressure and mbufFreeMin to size the msys pools for the number of
+ * subscribers a value is sent to at once.
+ */
+const NimBLEServer::TxStats& NimBLEServer::getTxStats() const {
+    return m_txStats;
+} // getTxStats
+
+/**
+ * @brief Reset the notification and indication transmit statistics.
+ */
+void NimBLEServer::resetTxStats() {
+    m_txStats = TxStats{};
+} // resetTxStats
+
+/**
+ * @brief Send notifications for several characteristics at once.
+ * @param [in] items The characteristics and values to send.
+ * @param [in] count The number of items.
+ * @param [in] connHandle The connection to send to, or BLE_HS_CONN_HANDLE_NONE for all connected peers.
+ * @return True if the values were sent to every peer, false if any send failed.
+ * @details Each peer receives only the values of the characteristics it is subscribed to. When the peer supports
+ * it the values are packed into Multiple Handle Value Notification PDUs (ATT 5.2), so several small updates share
+ * one PDU and its buffers. Otherwise a notification is sent for each value.
+ */
+bool NimBLEServer::notifyMultiple(const NotifyBatchItem* items, size_t count, uint16_t connHandle) {
+    bool success = true;
+    for (const auto& peer : m_peers) {
+        if (peer.connHandle == BLE_HS_CONN_HANDLE_NONE ||
+            (connHandle != BLE_HS_CONN_HANDLE_NONE && peer.connHandle != connHandle)) {
+            continue;
+        }
+
+        if (!sendBatch(peer.connHandle, items, count)) {
+            success = false;
+        }
+    }
+
+    return success;
+} // notifyMultiple
+
+/**
+ * @brief Send notifications of the current values of several characteristics at once.
+ * @param [in] chrs The characteristics to send.
+ * @param [in] connHandle The connection to send to, or BLE_HS_CONN_HANDLE_NONE for all connected peers.
+ * @return True if the values were sent to every peer, false if any send failed.
+ */
+bool NimBLEServer::notifyMultiple(const std::vector<NimBLECharacteristic*>& chrs, uint16_t connHandle) {
+    std::vector<NimBLEAttValue>  values{};
+    std::vector<NotifyBatchItem> items{};
+    values.reserve(chrs.size()); // items point into values, it must not reallocate
+    items.reserve(chrs.size());
+    for (const auto& pChr : chrs) {
+        values.push_back(pChr->getValue()); // make a copy to avoid issues if the value is changed while notifying
+        items.push_back(NotifyBatchItem{pChr, values.back().data(), values.back().size()});
+    }
+
+    return notifyMultiple(items.data(), items.size(), connHandle);
+} // notifyMultiple
+
+/**
+ * @brief Send a batch of notifications to a single connection.
+ * @param [in] connHandle The connection handle.
+ * @param [in] items The characteristics and values to send.
+ * @param [in] count The number of items.
+ * @return True if all values the peer is subscribed to were sent.
+ */
+bool NimBLEServer::sendBatch(uint16_t connHandle, const NotifyBatchItem* items, size_t count) {
+    std::vector<ble_gatt_notif> tuples{};
+    tuples.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        NimBLECharacteristic::TargetArray targets{};
+        if (items[i].pChr == nullptr || items[i].pChr->getSendTargets(connHandle, targets) == 0) {
+            continue; // not subscribed
+        }
+
+        os_mbuf* om = ble_hs_mbuf_from_flat(items[i].value, items[i].length);
+        if (!om) {
+            m_txStats.mbufAllocFail++;
+            for (auto& tuple : tuples) {
+                os_mbuf_free_chain(tuple.value);
+            }
+
+            NIMBLE_LOGE(LOG_TAG, "notifyMultiple: failed to allocate buffer");
+            return false;
+        }
+
+        tuples.push_back(ble_gatt_notif{items[i].pChr->getHandle(), om});
+    }
+
+    if (tuples.empty()) {
+        return true;
+    }
+
+    int rc = 0;
+# if MYNEWT_VAL(BLE_GATT_NOTIFY_MULTIPLE)
+    uint8_t clientFeatures = 0;
+    if (tuples.size() > 1 && ble_gatts_peer_cl_sup_feat_get(connHandle, &clientFeatures, 1) == 0 &&
+        (clientFeatures & 0x04)) { // Client Supported Features bit 2: Multiple Handle Value Notifications
+        rc = ble_gatts_notify_multiple_custom(connHandle, tuples.size(), tuples.data());
+        if (rc == 0) {
+            m_txStats.sent        += tuples.size();
+            m_txStats.multiValues += tuples.size();
+            m_txStats.multiSent++;
+            return true;
+        }
+
+        m_txStats.failed += tuples.size();
+        NIMBLE_LOGE(LOG_TAG, "notifyMultiple: rc=%d %s", rc, NimBLEUtils::returnCodeToString(rc));
+        return false;
+    }
+# endif
+
+    for (auto& tuple : tuples) {
+        int err = ble_gatts_notify_custom(connHandle, tuple.handle, tuple.value);
+        if (err == 0) {
+            m_txStats.sent++;
+        } else {
+            m_txStats.failed++;
+            rc = err;
+        }
+    }
+
+    if (rc != 0) {
+        NIMBLE_LOGE(LOG_TAG, "notifyMultiple: rc=%d %s", rc, NimBLEUtils::returnCodeToString(rc));
+        return false;
+    }
+
+    return true;
+} // sendBatch
+
+/**
+ * @brief Queue an indication to be sent when the connection has no other indication outstanding.
+ * @param [in] pChr The characteristic to indicate.
+ * @param [in] value A pointer to the data to send.
+ * @param [in] length The length of the data to send.
+ * @param [in] connHandle The connection to send to, or BLE_HS_CONN_HANDLE_NONE for all subscribers.
+ * @param [in] cb Optional callback invoked from the NimBLE host task for each connection once the indication
+ * is confirmed, fails or times out.
+ * @return True if the indication was queued for every target connection.
+ * @details Indications from all characteristics share one queue per connection, each is released to the stack
+ * when the previous one is confirmed so callers never have to wait for or retry an indication in flight.
+ * A connection queue holds at most CONFIG_NIMBLE_CPP_INDICATE_QUEUE_DEPTH indications.
+ */
+bool NimBLEServer::queueIndication(
+    NimBLECharacteristic* pChr, const uint8_t* value, size_t length, uint16_t connHandle, IndicationCallback cb) {
+    if (pChr == nullptr) {
+        return false;
+    }
+
+    if (!m_pIndPipeline) {
+        m_pIndPipeline = new IndicationPipeline(this);
+        if (!m_pIndPipeline->m_valid) {
+            delete m_pIndPipeline;
+            m_pIndPipeline = nullptr;
+            return false;
+        }
+    }
+
+    NimBLECharacteristic::TargetArray targets{};
+    size_t                            numTargets = pChr->getSendTargets(connHandle, targets);
+    if (numTargets == 0) {
+        if (connHandle != BLE_HS_CONN_HANDLE_NONE) {
+            return false;
+        }
+
+        if (cb) {
+            cb(pChr, BLE_HS_CONN_HANDLE_NONE, 0);
+        }
+        return true;
+    }
+
+    bool queued = true;
+    {
+        NimBLEMutexGuard g(m_pIndPipeline->m_mutex);
+        if (!g) {
+            return false;
+        }
+
+        for (size_t i = 0; i < numTargets; i++) {
+            auto* pConn = m_pIndPipeline->find(targets[i]);
+            if (!pConn) {
+                pConn = m_pIndPipeline->find(BLE_HS_CONN_HANDLE_NONE);
+            }
+
+            if (!pConn || pConn->items.size() >= MYNEWT_VAL(NIMBLE_CPP_INDICATE_QUEUE_DEPTH)) {
+                NIMBLE_LOGD(LOG_TAG, "Indication queue full, connHandle=%d", targets[i]);
+                m_indStats.dropped++;
+                queued = false;
+                continue;
+            }
+
+            pConn->connHandle = targets[i];
+            pConn->items.push_back(
+                IndicationPipeline::Item{pChr, pChr->getHandle(), std::vector<uint8_t>(value, value + length), cb});
+            m_indStats.queued++;
+            if (pConn->items.size() > m_indStats.depthMax) {
+                m_indStats.depthMax = pConn->items.size();
+            }
+        }
+    }
+
+    ble_npl_eventq_put(nimble_port_get_dflt_eventq(), &m_pIndPipeline->m_event);
+    return queued;
+} // queueIndication
+
+/**
+ * @brief Set how long to wait for a peer to confirm a queued indication.
+ * @param [in] timeoutMs The time in milliseconds, 0 relies on the 30 second ATT transaction timeout of the stack.
+ * @details The timeout only reports the indication, it does not release it. When it expires the completion
+ * callback of the indication is called with BLE_HS_ETIMEOUT and it is counted in IndicationStats::timedOut.
+ * ATT allows a single outstanding indication per connection, so the queue of the connection stays blocked until
+ * the peer confirms the indication or the stack releases it at its ATT transaction timeout, which ends the link.
+ */
+void NimBLEServer::setIndicationTimeout(uint32_t timeoutMs) {
+    if (!m_pIndPipeline) {
+        m_pIndPipeline = new IndicationPipeline(this);
+        if (!m_pIndPipeline->m_valid) {
+            delete m_pIndPipeline;
+            m_pIndPipeline = nullptr;
+            return;
+        }
+    }
+
+    NimBLEMutexGuard g(m_pIndPipeline->m_mutex);
+    if (g) {
+        m_pIndPipeline->m_timeout = ble_npl_time_ms_to_ticks32(timeoutMs);
+    }
+} // setIndicationTimeout
+
+/**
+ * @brief Get the number of indications queued for a connection.
+ * @param [in] connHandle The connection handle.
+ * @return The number of queued indications, including the one waiting for confirmation.
+ */
+size_t NimBLEServer::getIndicationQueueDepth(uint16_t connHandle) const {
+    if (!m_pIndPipeline || connHandle == BLE_HS_CONN_HANDLE_NONE) {
+        return 0;
+    }
+
+    NimBLEMutexGuard g(m_pIndPipeline->m_mutex);
+    if (!g) {
+        return 0;
+    }
+
+    auto* pConn = m_pIndPipeline->find(connHandle);
+    return pConn ? pConn->items.size() : 0;
+} // getIndicationQueueDepth
+
+/**
+ * @brief Get the indication queue statistics.
+ */
+const NimBLEServer::IndicationStats& NimBLEServer::getIndicationStats() const {
+    return m_indStats;
+} // getIndicationStats
+
+/**
+ * @brief Reset the indication queue statistics.
+ */
+void NimBLEServer::resetIndicationStats() {
+    m_indStats = IndicationStats{};
+} // resetIndicationStats
+
+/**
+ * @brief Event callback to service the indication queues.
+ * @param [in] ev Pointer to the event that triggered the callback.
+ */
+void NimBLEServer::indicationEventCb(struct ble_npl_event* ev) {
+    auto* pServer = static_cast<NimBLEServer*>(ble_npl_event_get_arg(ev));
+    if (pServer) {
+        pServer->processIndications();
+    }
+} // indicationEventCb
+
+/**
+ * @brief Report expired indications and send the next indication on every idle connection.
+ * @details Called only from the NimBLE host task. The indications are sent without holding the lock, a failed
+ * indication reports its completion synchronously. When the stack is out of buffers a short retry is
+ * scheduled, the callout is otherwise armed for the earliest indication timeout.
+ */
+void NimBLEServer::processIndications() {
+    IndicationPipeline* p = m_pIndPipeline;
+    if (!p) {
+        return;
+    }
+
+    std::vector<IndicationPipeline::Done> done{};
+    ble_npl_time_t                        wait = 0;
+    bool                                  more = true;
+    while (more) {
+        more = false;
+        std::vector<IndicationPipeline::Send> sends{};
+        {
+            NimBLEMutexGuard g(p->m_mutex);
+            if (!g) {
+                return;
+            }
+
+            ble_npl_time_t now = ble_npl_time_get();
+            for (auto& conn : p->m_conns) {
+                if (conn.connHandle == BLE_HS_CONN_HANDLE_NONE) {
+                    continue;
+                }
+
+                if (conn.inFlight) {
+                    if (p->m_timeout > 0 && !conn.timedOut) {
+                        ble_npl_time_t elapsed = now - conn.sentAt;
+                        if (elapsed >= p->m_timeout) {
+                            auto& item    = conn.items.front();
+                            conn.timedOut = true;
+                            m_indStats.timedOut++;
+                            done.push_back({item.pChr, conn.connHandle, BLE_HS_ETIMEOUT, std::move(item.cb)});
+                            item.cb = nullptr;
+                        } else if (wait == 0 || p->m_timeout - elapsed < wait) {
+                            wait = p->m_timeout - elapsed;
+                        }
+                    }
+                    continue;
+                }
+
+                if (conn.sending || conn.directPending || conn.items.empty()) {
+                    continue;
+                }
+
+                const auto& item = conn.items.front();
+                conn.sending     = true;
+                sends.push_back({conn.connHandle, item.attrHandle, item.value, 0});
+            }
+        }
+
+        for (auto& send : sends) {
+            size_t numSent = 0;
+            send.rc        = NimBLECharacteristic::sendToTargets(send.attrHandle,
+                                                                 send.value.data(),
+                                                                 send.value.size(),
+                                                                 false,
+                                                                 &send.connHandle,
+                                                                 1,
+                                                                 &numSent,
+                                                                 false);
+        }
+
+        NimBLEMutexGuard g(p->m_mutex);
+        if (!g) {
+            return;
+        }
+
+        ble_npl_time_t now = ble_npl_time_get();
+        for (const auto& send : sends) {
+            auto* pConn = p->find(send.connHandle);
+            if (!pConn || !pConn->sending) {
+                continue; // the connection closed while sending
+            }
+
+            pConn->sending = false;
+            if (send.rc == 0) {
+                pConn->inFlight = true;
+                pConn->timedOut = false;
+                pConn->sentAt   = now;
+                if (p->m_timeout > 0 && (wait == 0 || p->m_timeout < wait)) {
+                    wait = p->m_timeout;
+                }
+                continue;
+            }
+
+            if (send.rc == BLE_HS_ENOMEM) {
+                ble_npl_time_t retry = ble_npl_time_ms_to_ticks32(MYNEWT_VAL(NIMBLE_CPP_NOTIFY_RETRY_MS));
+                retry                = retry > 0 ? retry : 1;
+                if (wait == 0 || retry < wait) {
+                    wait = retry;
+                }
+                continue;
+            }
+
+            auto& item = pConn->items.front();
+            m_indStats.failed++;
+            done.push_back({item.pChr, pConn->connHandle, send.rc, std::move(item.cb)});
+            pConn->items.pop_front();
+            more = true; // try the next indication of the connection
+        }
+    }
+
+    if (wait > 0) {
+        ble_npl_callout_reset(&p->m_timer, wait);
+    }
+
+    for (auto& d : done) {
+        if (d.cb) {
+            d.cb(d.pChr, d.connHandle, d.rc);
+        }
+    }
+} // processIndications
+
+/**
+ * @brief Release the indication in flight on a connection once the stack reports its outcome.
+ * @param [in] connHandle The connection handle.
+ * @param [in] attrHandle The handle of the indicated characteristic.
+ * @param [in] status BLE_HS_EDONE if the peer confirmed the indication, otherwise the error.
+ */
+void NimBLEServer::indicationDone(uint16_t connHandle, uint16_t attrHandle, int status) {
+    IndicationPipeline* p = m_pIndPipeline;
+    if (!p) {
+        return;
+    }
+
+    IndicationPipeline::Item item{};
+    int                      rc = status == BLE_HS_EDONE ? 0 : status;
+    {
+        NimBLEMutexGuard g(p->m_mutex);
+        if (!g) {
+            return;
+        }
+
+        // A failure reported while the pipeline is sending is its own, handled by processIndications.
+        auto* pConn = p->find(connHandle);
+        if (!pConn || pConn->sending) {
+            return;
+        }
+
+        // ATT allows one outstanding indication per connection, so the completion belongs to its owner.
+        if (pConn->directPending) {
+            pConn->directPending = false;
+            if (!pConn->items.empty()) {
+                ble_npl_eventq_put(nimble_port_get_dflt_eventq(), &p->m_event);
+            }
+            return;
+        }
+
+        if (!pConn->inFlight || pConn->items.front().attrHandle != attrHandle) {
+            return; // not sent through the queue
+        }
+
+        item = std::move(pConn->items.front());
+        pConn->items.pop_front();
+        pConn->inFlight = false;
+        if (rc == 0) {
+            uint32_t rtt = ble_npl_time_ticks_to_ms32(ble_npl_time_get() - pConn->sentAt);
+            m_indStats.confirmed++;
+            m_indStats.rttLastMs   = rtt;
+            m_indStats.rttTotalMs += rtt;
+            if (rtt < m_indStats.rttMinMs) {
+                m_indStats.rttMinMs = rtt;
+            }
+            if (rtt > m_indStats.rttMaxMs) {
+                m_indStats.rttMaxMs = rtt;
+            }
+        } else if (!pConn->timedOut) {
+            m_indStats.failed++;
+        }
+    }
+
+    if (item.cb) {
+        item.cb(item.pChr, connHandle, rc);
+    }
+
+    processIndications();
+} // indicationDone
+
+/**
+ * @brief Reserve a connection for an indication sent with indicate(), outside the queue.
+ * @param [in] connHandle The connection handle.
+ * @return False if a queued indication is outstanding on the connection, the indication must not be sent.
+ * @details ATT allows a single outstanding indication per connection. While the reservation is held the queue
+ * does not send on the connection and the next completion reported for it belongs to the direct indication.
+ */
+bool NimBLEServer::beginDirectIndication(uint16_t connHandle) {
+    IndicationPipeline* p = m_pIndPipeline;
+    if (!p) {
+        return true;
+    }
+
+    NimBLEMutexGuard g(p->m_mutex);
+    if (!g) {
+        return false;
+    }
+
+    auto* pConn = p->find(connHandle);
+    if (!pConn) {
+        pConn = p->find(BLE_HS_CONN_HANDLE_NONE);
+        if (!pConn) {
+            return true; // no queue can be in use on the connection
+        }
+        pConn->connHandle = connHandle;
+    }
+
+    if (pConn->inFlight || pConn->sending || pConn->directPending) {
+        return false;
+    }
+
+    pConn->directPending = true;
+    return true;
+} // beginDirectIndication
+
+/**
+ * @brief Release the reservation of a direct indication that could not be sent.
+ * @param [in] connHandle The connection handle.
+ */
+void NimBLEServer::endDirectIndication(uint16_t connHandle) {
+    IndicationPipeline* p = m_pIndPipeline;
+    if (!p) {
+        return;
+    }
+
+    NimBLEMutexGuard g(p->m_mutex);
+    if (!g) {
+        return;
+    }
+
+    auto* pConn = p->find(connHandle);
+    if (pConn && pConn->directPending) {
+        pConn->directPending = false;
+        if (!pConn->items.empty()) {
+            ble_npl_eventq_put(nimble_port_get_dflt_eventq(), &p->m_event);
+        }
+    }
+} // endDirectIndication
+
+/**
+ * @brief Discard queued indications and report them as failed.
+ * @param [in] connHandle The connection to discard indications for, or BLE_HS_CONN_HANDLE_NONE for all.
+ * @param [in] pChr Only discard indications of this characteristic, or nullptr for all.
+ * @param [in] rc The error to report to the completion callbacks.
+ * @details Used when a connection closes or a characteristic is deleted. An indication in flight for a
+ * deleted characteristic stays in the queue without its callback so the queue waits for the stack to release it.
+ */
+void NimBLEServer::flushIndications(uint16_t connHandle, const NimBLECharacteristic* pChr, int rc) {
+    IndicationPipeline* p = m_pIndPipeline;
+    if (!p) {
+        return;
+    }
+
+    std::vector<IndicationPipeline::Done> dropped{};
+    {
+        NimBLEMutexGuard g(p->m_mutex);
+        if (!g) {
+            return;
+        }
+
+        for (auto& conn : p->m_conns) {
+            if (conn.connHandle == BLE_HS_CONN_HANDLE_NONE ||
+                (connHandle != BLE_HS_CONN_HANDLE_NONE && conn.connHandle != connHandle)) {
+                continue;
+            }
+
+            for (auto it = conn.items.begin(); it != conn.items.end();) {
+                if (pChr && it->pChr != pChr) {
+                    ++it;
+                    continue;
+                }
+
+                dropped.push_back({it->pChr, conn.connHandle, rc, std::move(it->cb)});
+                if (pChr && (conn.inFlight || conn.sending) && it == conn.items.begin()) {
+                    // Keep the entry so the queue stays blocked until the stack releases the indication.
+                    it->pChr = nullptr;
+                    it->cb   = nullptr;
+                    ++it;
+                    continue;
+                }
+
+                m_indStats.dropped++;
+                it = conn.items.erase(it);
+            }
+
+            if (!pChr) {
+                conn = IndicationPipeline::Conn{}; // connection closed, release the queue
+            }
+        }
+    }
+
+    for (auto& d : dropped) {
+        if (d.cb) {
+            d.cb(d.pChr, d.connHandle, d.rc);
+        }
+    }
+} // flushIndications
+
 /**
  * @brief Request an Update the connection parameters:
  * * Can only be used after a connection has been established.
@@ -34,6 +34,15 @@
 
 # include <vector>
 # include <array>
+# include <functional>
+
+# ifndef MYNEWT_VAL_NIMBLE_CPP_INDICATE_QUEUE_DEPTH
+#  ifndef CONFIG_NIMBLE_CPP_INDICATE_QUEUE_DEPTH
+#   define MYNEWT_VAL_NIMBLE_CPP_INDICATE_QUEUE_DEPTH 8
+#  else
+#   define MYNEWT_VAL_NIMBLE_CPP_INDICATE_QUEUE_DEPTH CONFIG_NIMBLE_CPP_INDICATE_QUEUE_DEPTH
+#  endif
+# endif
 
 # define NIMBLE_ATT_REMOVE_HIDE   1
 # define NIMBLE_ATT_REMOVE_DELETE 2
@@ -45,6 +54,7 @@ class NimBLEConnInfo;
 class NimBLEAddress;
 class NimBLEService;
 class NimBLECharacteristic;
+class NimBLELocalAttribute;
 # if MYNEWT_VAL(BLE_ROLE_BROADCASTER)
 #  if MYNEWT_VAL(BLE_EXT_ADV)
 class NimBLEExtAdvertising;
@@ -75,6 +85,8 @@ class NimBLEServer {
     NimBLECharacteristic* getCharacteristicByHandle(uint16_t handle) const;
     void                  removeService(NimBLEService* service, bool deleteSvc = false);
     void                  addService(NimBLEService* service);
+    bool                  addStaticServices(const ble_gatt_svc_def* svcs);
+    void                  removeStaticServices(const ble_gatt_svc_def* svcs);
     uint16_t              getPeerMTU(uint16_t connHandle) const;
     std::vector<uint16_t> getPeerDevices() const;
     NimBLEConnInfo        getPeerInfo(uint8_t index) const;
@@ -85,6 +97,67 @@ class NimBLEServer {
     bool                  updatePhy(uint16_t connHandle, uint8_t txPhysMask, uint8_t rxPhysMask, uint16_t phyOptions);
     bool                  getPhy(uint16_t connHandle, uint8_t* txPhy, uint8_t* rxPhy);
     void                  sendServiceChangedIndication() const;
+    bool                  getDatabaseHash(std::array<uint8_t, 16>& hash) const;
+
+    /**
+     * @brief Notification and indication transmit statistics, shared by all characteristics of the server.
+     */
+    struct TxStats {
+        uint32_t sent{0};             // Notifications/indications accepted by the stack.
+        uint32_t failed{0};           // Notifications/indications rejected by the stack.
+        uint32_t mbufAllocFail{0};    // Payload buffers that could not be allocated after retrying.
+        uint32_t mbufPressure{0};     // Sends started with fewer free msys blocks than the fan-out needed.
+        uint16_t mbufFreeMin{0xFFFF}; // Lowest free msys block count observed before a send.
+        uint32_t multiSent{0};        // Multiple Handle Value Notification PDUs sent by notifyMultiple.
+        uint32_t multiValues{0};      // Values carried in those PDUs, multiValues - multiSent PDUs were saved.
+    };
+
+    const TxStats& getTxStats() const;
+    void           resetTxStats();
+
+    /**
+     * @brief A characteristic value to send with notifyMultiple.
+     */
+    struct NotifyBatchItem {
+        NimBLECharacteristic* pChr;
+        const uint8_t*        value;
+        size_t                length;
+    };
+
+    bool notifyMultiple(const NotifyBatchItem* items, size_t count, uint16_t connHandle = BLE_HS_CONN_HANDLE_NONE);
+    bool notifyMultiple(const std::vector<NimBLECharacteristic*>& chrs, uint16_t connHandle = BLE_HS_CONN_HANDLE_NONE);
+
+    /**
+     * @brief Called when a queued indication has been confirmed by the peer, has failed or has timed out.
+     * @details rc is 0 when the peer confirmed the indication, otherwise the error that ended it.
+     */
+    using IndicationCallback = std::function<void(NimBLECharacteristic* pCharacteristic, uint16_t connHandle, int rc)>;
+
+    /**
+     * @brief Statistics of the indication queues, shared by all connections.
+     */
+    struct IndicationStats {
+        uint32_t queued{0};            // Indications accepted into a connection queue.
+        uint32_t confirmed{0};         // Indications confirmed by the peer.
+        uint32_t failed{0};            // Indications rejected by the stack or not confirmed.
+        uint32_t timedOut{0};          // Indications not confirmed within the configured timeout.
+        uint32_t dropped{0};           // Indications refused on a full queue or discarded on disconnect.
+        uint16_t depthMax{0};          // Highest number of indications waiting on one connection.
+        uint32_t rttLastMs{0};         // Round trip time of the last confirmed indication.
+        uint32_t rttMinMs{0xFFFFFFFF}; // Lowest round trip time observed.
+        uint32_t rttMaxMs{0};          // Highest round trip time observed.
+        uint32_t rttTotalMs{0};        // Sum of all round trip times, divide by confirmed for the average.
+    };
+
+    bool                   queueIndication(NimBLECharacteristic* pChr,
+                                           const uint8_t*        value,
+                                           size_t                length,
+                                           uint16_t              connHandle = BLE_HS_CONN_HANDLE_NONE,
+                                           IndicationCallback    cb         = nullptr);
+    void                   setIndicationTimeout(uint32_t timeoutMs);
+    size_t                 getIndicationQueueDepth(uint16_t connHandle) const;
+    const IndicationStats& getIndicationStats() const;
+    void                   resetIndicationStats();
 
 # if MYNEWT_VAL(BLE_ROLE_CENTRAL)
     NimBLEClient* getClient(uint16_t connHandle);
@@ -125,16 +198,59 @@ class NimBLEServer {
     static void gattRegisterCallback(struct ble_gatt_register_ctxt* ctxt, void* arg);
     void        setServiceChanged();
     bool        resetGATT();
+    void        setHandleEntry(uint16_t handle, NimBLELocalAttribute* pAttr, uint8_t type);
+    int         getConnIndex(uint16_t connHandle) const;
+    bool        addPeer(const ble_gap_conn_desc& desc);
+    void        removePeer(uint16_t connHandle);
+    void        refreshPeer(uint16_t connHandle);
+    bool        findPeerInfo(uint16_t connHandle, NimBLEConnInfo& connInfo) const;
+    bool        sendBatch(uint16_t connHandle, const NotifyBatchItem* items, size_t count);
+
+    struct IndicationPipeline;
+    void        processIndications();
+    void        indicationDone(uint16_t connHandle, uint16_t attrHandle, int status);
+    bool        beginDirectIndication(uint16_t connHandle);
+    void        endDirectIndication(uint16_t connHandle);
+    void        flushIndications(uint16_t connHandle, const NimBLECharacteristic* pChr, int rc);
+    static void indicationEventCb(struct ble_npl_event* ev);
+
+    /**
+     * @brief A connected peer, kept up to date from GAP events so lookups do not need to query the host.
+     * @details Entries are placed by connection handle modulo the table size, so a lookup normally hits on the first
+     * probe. txPhy and rxPhy are 0 until the PHY has been read or updated.
+     */
+    struct PeerEntry {
+        ble_gap_conn_desc desc{};
+        uint16_t          connHandle{BLE_HS_CONN_HANDLE_NONE};
+        uint16_t          mtu{0};
+        uint8_t           txPhy{0};
+        uint8_t           rxPhy{0};
+    };
+
+    /** @brief An entry of the handle lookup table, type is one of the BLE_GATT_REGISTER_OP_* values. */
+    struct HandleEntry {
+        NimBLELocalAttribute* pAttr{nullptr};
+        uint8_t               type{0};
+    };
 
     bool m_gattsStarted : 1;
     bool m_svcChanged : 1;
     bool m_deleteCallbacks : 1;
+    bool m_dbHashValid : 1;
 # if !MYNEWT_VAL(BLE_EXT_ADV) && MYNEWT_VAL(BLE_ROLE_BROADCASTER)
     bool m_advertiseOnDisconnect : 1;
 # endif
-    NimBLEServerCallbacks*                                m_pServerCallbacks;
-    std::vector<NimBLEService*>                           m_svcVec;
-    std::array<uint16_t, MYNEWT_VAL(BLE_MAX_CONNECTIONS)> m_connectedPeers;
+    NimBLEServerCallbacks*                                 m_pServerCallbacks;
+    std::vector<NimBLEService*>                            m_svcVec;
+    std::vector<const ble_gatt_svc_def*>                   m_staticSvcs{};
+    std::array<PeerEntry, MYNEWT_VAL(BLE_MAX_CONNECTIONS)> m_peers{};
+    uint8_t                                                m_connCount{0};
+    TxStats                                                m_txStats{};
+    std::vector<HandleEntry>                               m_handleTable{};
+    IndicationPipeline*                                    m_pIndPipeline{nullptr};
+    std::vector<NimBLECharacteristic*>                     m_peerValueChrs{}; // modified on the host task only
+    IndicationStats                                        m_indStats{};
+    std::array<uint8_t, 16>                                m_dbHash{};
 
 # if MYNEWT_VAL(BLE_ROLE_CENTRAL)
     NimBLEClient* m_pClient{nullptr};
@@ -261,6 +261,7 @@ void NimBLEService::removeCharacteristic(NimBLECharacteristic* pChar, bool delet
         if (deleteChr) {
             for (auto it = m_vChars.begin(); it != m_vChars.end(); ++it) {
                 if ((*it) == pChar) {
+                    getServer()->setHandleEntry(pChar->getHandle(), nullptr, 0);
                     delete (*it);
                     m_vChars.erase(it);
                     break;
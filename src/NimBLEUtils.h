@@ -41,6 +41,12 @@ void nimble_cpp_assert(const char *file, unsigned line) __attribute((weak, noret
 # define NIMBLE_CPP_DEBUG_ASSERT(cond) (void(0))
 #endif
 
+# ifdef USING_NIMBLE_ARDUINO_HEADERS
+#  include "nimble/nimble/include/nimble/nimble_npl.h"
+# else
+#  include "nimble/nimble_npl.h"
+# endif
+
 # include <string>
 
 class NimBLEAddress;
@@ -62,6 +68,26 @@ struct NimBLETaskData {
     friend class NimBLEUtils;
 };
 
+/**
+ * @brief Scoped lock of a NimBLE mutex.
+ * @details The pend can fail, for example if the mutex was not initialized, test the guard before
+ * touching the guarded state.
+ */
+struct NimBLEMutexGuard {
+    explicit NimBLEMutexGuard(ble_npl_mutex& m)
+        : _m(m), _locked(ble_npl_mutex_pend(&m, BLE_NPL_TIME_FOREVER) == BLE_NPL_OK) {}
+    ~NimBLEMutexGuard() {
+        if (_locked) ble_npl_mutex_release(&_m);
+    }
+    NimBLEMutexGuard(const NimBLEMutexGuard&)            = delete;
+    NimBLEMutexGuard& operator=(const NimBLEMutexGuard&) = delete;
+    operator bool() const { return _locked; }
+
+  private:
+    ble_npl_mutex& _m;
+    bool           _locked;
+};
+
 /**
  * @brief A BLE Utility class with methods for debugging and general purpose use.
  */
@@ -78,6 +78,17 @@ class NimBLEValueAttribute {
         return m_value;
     }
 
+    /**
+     * @brief Template to decode the attribute value into fields with a NimBLESchema.
+     * @tparam Schema The NimBLESchema type describing the payload layout.
+     * @param [out] values References to the variables to receive the field values, in schema order.
+     * @return True if the value was at least the schema size and the fields were decoded.
+     */
+    template <typename Schema, typename... Args>
+    bool getFields(Args&... values) const {
+        return m_value.getFields<Schema>(values...);
+    }
+
   protected:
     NimBLEAttValue m_value{};
 };